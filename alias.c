@@ -94,7 +94,8 @@ static ADDRESS *mutt_expand_aliases_r (ADDRESS *a, LIST **expn)
 	  char namebuf[STRING];
 	  
 	  mutt_gecos_name (namebuf, sizeof (namebuf), pw);
-	  mutt_str_replace (&a->personal, namebuf);
+	  mutt_str_unintern (&a->personal);
+	  a->personal = safe_strdup (namebuf);
 	  
 #ifdef EXACT_ADDRESS
 	  FREE (&a->val);
@@ -346,6 +346,245 @@ int iconv_close (iconv_t cd)
 #endif /* !HAVE_ICONV */
 
 
+/*
+ * iconv_open() has to find and set up the conversion modules, which
+ * costs far more than most of the conversions we do with the result,
+ * e.g. of a single encoded word.  So the descriptors are cached, keyed
+ * by the names actually handed to iconv_open(), i.e. after all hooks
+ * have been applied.  A descriptor is only ever in use by one caller.
+ */
+
+#define ICONV_CACHE_SIZE 8
+
+static struct iconv_cache
+{
+  char *tocode;
+  char *fromcode;
+  iconv_t cd;
+  short busy;			/* handed out and not closed yet */
+  short flags;			/* input passed through unchanged, see below */
+  unsigned int used;		/* for replacing the least recently used */
+} IconvCache[ICONV_CACHE_SIZE];
+
+static unsigned int IconvCacheClock = 0;
+
+/* which input a cached descriptor converts to itself */
+#define ICONV_ASCII	(1<<0)	/* 7-bit input */
+#define ICONV_UTF8	(1<<1)	/* valid UTF-8 */
+#define ICONV_8BIT	(1<<2)	/* anything */
+
+/* how often mutt_iconv_passthrough() let the caller skip iconv() */
+static unsigned long IconvPassed = 0, IconvConverted = 0;
+
+/* Shifting encodings may pass 7-bit text through unchanged in one
+ * state but not in another, so we never bypass iconv for them. */
+static int stateful_charset (const char *cs)
+{
+  return (strstr (cs, "2022") || !ascii_strncasecmp (cs, "utf-7", 5) ||
+	  !ascii_strncasecmp (cs, "utf7", 4) || !ascii_strncasecmp (cs, "hz", 2));
+}
+
+/* Does cd convert the len bytes at probe to themselves? */
+static int iconv_probe (iconv_t cd, const char *probe, size_t len)
+{
+  char buf[512];
+  ICONV_CONST char *ib = (ICONV_CONST char *) probe;
+  char *ob = buf;
+  size_t ibl = len, obl = sizeof (buf);
+  int rc;
+
+  rc = (iconv (cd, &ib, &ibl, &ob, &obl) == 0 && !ibl &&
+	(size_t) (ob - buf) == len && !memcmp (buf, probe, len));
+  iconv (cd, 0, 0, 0, 0);
+
+  return rc;
+}
+
+static int iconv_passthrough_flags (iconv_t cd, const char *tocode,
+				    const char *fromcode)
+{
+  char probe[256];
+  int i, flags = 0;
+
+  if (stateful_charset (tocode) || stateful_charset (fromcode))
+    return 0;
+
+  for (i = 0; i < 256; i++)
+    probe[i] = i;
+  if (!iconv_probe (cd, probe, 128))
+    return 0;
+
+  flags = ICONV_ASCII;
+  if (iconv_probe (cd, probe, 256))
+    flags |= ICONV_8BIT;
+  else if (mutt_is_utf8 (tocode) && mutt_is_utf8 (fromcode))
+    flags |= ICONV_UTF8;
+
+  return flags;
+}
+
+static iconv_t iconv_cache_open (const char *tocode, const char *fromcode)
+{
+  struct iconv_cache *c, *slot = NULL;
+  iconv_t cd;
+  int i;
+
+  for (i = 0; i < ICONV_CACHE_SIZE; i++)
+  {
+    c = &IconvCache[i];
+    if (!c->tocode)
+    {
+      if (!slot || slot->tocode)
+	slot = c;
+      continue;
+    }
+    if (c->busy)
+      continue;
+    if (!mutt_strcmp (c->tocode, tocode) && !mutt_strcmp (c->fromcode, fromcode))
+    {
+      c->busy = 1;
+      c->used = ++IconvCacheClock;
+      return c->cd;
+    }
+    if (!slot || (slot->tocode && c->used < slot->used))
+      slot = c;
+  }
+
+  if ((cd = iconv_open (tocode, fromcode)) == (iconv_t) -1)
+    return cd;
+
+  /* all descriptors are in use, don't cache this one */
+  if (!slot)
+    return cd;
+
+  if (slot->tocode)
+  {
+    iconv_close (slot->cd);
+    FREE (&slot->tocode);
+    FREE (&slot->fromcode);
+  }
+  slot->tocode = safe_strdup (tocode);
+  slot->fromcode = safe_strdup (fromcode);
+  slot->cd = cd;
+  slot->busy = 1;
+  slot->flags = iconv_passthrough_flags (cd, tocode, fromcode);
+  slot->used = ++IconvCacheClock;
+
+  return cd;
+}
+
+/* Length of the initial run of 7-bit bytes in s, checked a word at a
+ * time. */
+static size_t ascii_span (const char *s, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) s;
+  unsigned long w;
+  size_t i = 0;
+
+  for (; i + sizeof (w) <= len; i += sizeof (w))
+  {
+    memcpy (&w, p + i, sizeof (w));
+    if (w & ((unsigned long) -1 / 0xff * 0x80))
+      break;
+  }
+  while (i < len && !(p[i] & 0x80))
+    i++;
+
+  return i;
+}
+
+/* Is s well-formed UTF-8, as accepted by iconv?  Overlong forms,
+ * surrogates and anything above U+10FFFF are rejected, and so is a
+ * character cut off at the end. */
+static int utf8_valid (const char *s, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) s;
+  const unsigned char *end = p + len;
+  unsigned char lo, hi;
+  int n;
+
+  while ((p += ascii_span ((const char *) p, end - p)) < end)
+  {
+    lo = 0x80, hi = 0xbf;
+    if (*p >= 0xc2 && *p <= 0xdf)
+      n = 1;
+    else if (*p >= 0xe0 && *p <= 0xef)
+    {
+      n = 2;
+      if (*p == 0xe0)
+	lo = 0xa0;
+      else if (*p == 0xed)
+	hi = 0x9f;
+    }
+    else if (*p >= 0xf0 && *p <= 0xf4)
+    {
+      n = 3;
+      if (*p == 0xf0)
+	lo = 0x90;
+      else if (*p == 0xf4)
+	hi = 0x8f;
+    }
+    else
+      return 0;
+
+    if (end - p <= n || p[1] < lo || p[1] > hi)
+      return 0;
+    for (p += 2; --n; p++)
+      if (*p < 0x80 || *p > 0xbf)
+	return 0;
+  }
+
+  return 1;
+}
+
+/*
+ * Would cd convert the len bytes at s to themselves?  Then the caller
+ * can skip calling iconv().  This is decided from what the descriptor
+ * was found to pass through unchanged when it was opened, so only
+ * descriptors from mutt_iconv_open() qualify.
+ */
+int mutt_iconv_passthrough (iconv_t cd, const char *s, size_t len)
+{
+  int i, flags = 0;
+
+  for (i = 0; i < ICONV_CACHE_SIZE; i++)
+    if (IconvCache[i].tocode && IconvCache[i].busy && IconvCache[i].cd == cd)
+    {
+      flags = IconvCache[i].flags;
+      break;
+    }
+
+  if ((flags & ICONV_8BIT) ||
+      ((flags & (ICONV_ASCII | ICONV_UTF8)) &&
+       ((flags & ICONV_UTF8) ? utf8_valid (s, len) : ascii_span (s, len) == len)))
+  {
+    IconvPassed++;
+    return 1;
+  }
+
+  IconvConverted++;
+  return 0;
+}
+
+/* Close the cached descriptors. */
+void mutt_iconv_cleanup (void)
+{
+  int i;
+
+  dprint (1, (debugfile, "mutt_iconv_cleanup: %lu of %lu buffers didn't need iconv\n",
+	      IconvPassed, IconvPassed + IconvConverted));
+
+  for (i = 0; i < ICONV_CACHE_SIZE; i++)
+  {
+    if (!IconvCache[i].tocode)
+      continue;
+    if (!IconvCache[i].busy)
+      iconv_close (IconvCache[i].cd);
+    FREE (&IconvCache[i].tocode);
+    FREE (&IconvCache[i].fromcode);
+  }
+}
+
 /*
  * Like iconv_open, but canonicalises the charsets, applies
  * charset-hooks, recanonicalises, and finally applies iconv-hooks.
@@ -358,6 +597,7 @@ int iconv_close (iconv_t cd)
  * in some setups. Note: By design charset-hooks should never be, and
  * are never, applied to tocode. Highlight note: The top-well-named
  * M_ICONV_HOOK_FROM acts on charset-hooks, not at all on iconv-hooks.
+ * The descriptor must be given back with mutt_iconv_close().
  */
 
 iconv_t mutt_iconv_open (const char *tocode, const char *fromcode, int flags)
@@ -386,12 +626,34 @@ iconv_t mutt_iconv_open (const char *tocode, const char *fromcode, int flags)
   fromcode2 = (fromcode2) ? fromcode2 : fromcode1;
 
   /* call system iconv with names it appreciates */
-  if ((cd = iconv_open (tocode2, fromcode2)) != (iconv_t) -1)
+  if ((cd = iconv_cache_open (tocode2, fromcode2)) != (iconv_t) -1)
     return cd;
   
   return (iconv_t) -1;
 }
 
+/*
+ * Give back a descriptor obtained from mutt_iconv_open().  Cached
+ * descriptors are reset to their initial state and kept for reuse.
+ */
+void mutt_iconv_close (iconv_t cd)
+{
+  int i;
+
+  if (cd == (iconv_t) -1)
+    return;
+
+  for (i = 0; i < ICONV_CACHE_SIZE; i++)
+    if (IconvCache[i].tocode && IconvCache[i].busy && IconvCache[i].cd == cd)
+    {
+      iconv (cd, 0, 0, 0, 0);
+      IconvCache[i].busy = 0;
+      return;
+    }
+
+  iconv_close (cd);
+}
+
 
 /*
  * Like iconv, but keeps going even when the input is invalid
@@ -490,6 +752,12 @@ int mutt_convert_string (char **ps, const char *from, const char *to, int flags)
     ICONV_CONST char **inrepls = 0;
     char *outrepl = 0;
 
+    if (mutt_iconv_passthrough (cd, s, strlen (s)))
+    {
+      mutt_iconv_close (cd);
+      return 0;
+    }
+
     if (mutt_is_utf8 (to))
       outrepl = "\357\277\275";
     else if (mutt_is_utf8 (from))
@@ -503,7 +771,7 @@ int mutt_convert_string (char **ps, const char *from, const char *to, int flags)
     ob = buf = safe_malloc (obl + 1);
     
     mutt_iconv (cd, &ib, &ibl, &ob, &obl, inrepls, outrepl);
-    iconv_close (cd);
+    mutt_iconv_close (cd);
 
     *ob = '\0';
 
@@ -591,6 +859,52 @@ char *fgetconvs (char *buf, size_t l, FGETCONV *_fc)
     return NULL;
 }
 
+/* Copy the pending input to the output buffer if converting it
+ * wouldn't change it.  bufo is as large as bufi, so it all fits. */
+static int fgetconv_passthrough (struct fgetconv_s *fc)
+{
+  if (!mutt_iconv_passthrough (fc->cd, fc->ib, fc->ibl))
+    return 0;
+
+  memcpy (fc->ob, fc->ib, fc->ibl);
+  fc->ob += fc->ibl;
+  fc->ib += fc->ibl;
+  fc->ibl = 0;
+  return 1;
+}
+
+/* Read up to l converted bytes into buf, which is not terminated.
+ * Returns the number of bytes read, 0 at the end of the file. */
+size_t fgetconvn (char *buf, size_t l, FGETCONV *_fc)
+{
+  struct fgetconv_s *fc = (struct fgetconv_s *)_fc;
+  size_t r = 0, k;
+  int c;
+
+  if (!fc)
+    return 0;
+  if (fc->cd == (iconv_t)-1)
+    return fread (buf, 1, l, fc->file);
+
+  while (r < l)
+  {
+    /* hand out what has already been converted in one go */
+    if (fc->p && fc->p < fc->ob)
+    {
+      k = MIN (l - r, fc->ob - fc->p);
+      memcpy (buf + r, fc->p, k);
+      fc->p += k;
+      r += k;
+      continue;
+    }
+    if ((c = fgetconv (_fc)) == EOF)
+      break;
+    buf[r++] = (char) c;
+  }
+
+  return r;
+}
+
 int fgetconv (FGETCONV *_fc)
 {
   struct fgetconv_s *fc = (struct fgetconv_s *)_fc;
@@ -609,7 +923,8 @@ int fgetconv (FGETCONV *_fc)
   if (fc->ibl)
   {
     size_t obl = sizeof (fc->bufo);
-    iconv (fc->cd, (ICONV_CONST char **)&fc->ib, &fc->ibl, &fc->ob, &obl);
+    if (!fgetconv_passthrough (fc))
+      iconv (fc->cd, (ICONV_CONST char **)&fc->ib, &fc->ibl, &fc->ob, &obl);
     if (fc->p < fc->ob)
       return (unsigned char)*(fc->p)++;
   }
@@ -633,8 +948,9 @@ int fgetconv (FGETCONV *_fc)
   if (fc->ibl)
   {
     size_t obl = sizeof (fc->bufo);
-    mutt_iconv (fc->cd, (ICONV_CONST char **)&fc->ib, &fc->ibl, &fc->ob, &obl,
-		fc->inrepls, 0);
+    if (!fgetconv_passthrough (fc))
+      mutt_iconv (fc->cd, (ICONV_CONST char **)&fc->ib, &fc->ibl, &fc->ob, &obl,
+		  fc->inrepls, 0);
     if (fc->p < fc->ob)
       return (unsigned char)*(fc->p)++;
   }
@@ -649,7 +965,7 @@ void fgetconv_close (FGETCONV **_fc)
   struct fgetconv_s *fc = (struct fgetconv_s *) *_fc;
 
   if (fc->cd != (iconv_t)-1)
-    iconv_close (fc->cd);
+    mutt_iconv_close (fc->cd);
   FREE (_fc);		/* __FREE_CHECKED__ */
 }
 
@@ -671,7 +987,7 @@ int mutt_check_charset (const char *s, int strict)
 
   if ((cd = mutt_iconv_open (s, s, 0)) != (iconv_t)(-1))
   {
-    iconv_close (cd);
+    mutt_iconv_close (cd);
     return 0;
   }
 
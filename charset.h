@@ -37,6 +37,9 @@ int iconv_close (iconv_t);
 int mutt_convert_string (char **, const char *, const char *, int);
 
 iconv_t mutt_iconv_open (const char *, const char *, int);
+void mutt_iconv_close (iconv_t);
+int mutt_iconv_passthrough (iconv_t, const char *, size_t);
+void mutt_iconv_cleanup (void);
 size_t mutt_iconv (iconv_t, ICONV_CONST char **, size_t *, char **, size_t *, ICONV_CONST char **, const char *);
 
 typedef void * FGETCONV;
@@ -44,6 +47,7 @@ typedef void * FGETCONV;
 FGETCONV *fgetconv_open (FILE *, const char *, const char *, int);
 int fgetconv (FGETCONV *);
 char * fgetconvs (char *, size_t, FGETCONV *);
+size_t fgetconvn (char *, size_t, FGETCONV *);
 void fgetconv_close (FGETCONV **);
 
 void mutt_set_langinfo_charset (void);
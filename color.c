@@ -35,6 +35,7 @@ int ColorDefs[MT_COLOR_MAX];
 COLOR_LINE *ColorHdrList = NULL;
 COLOR_LINE *ColorBodyList = NULL;
 COLOR_LINE *ColorIndexList = NULL;
+unsigned int ColorIndexGen = 1;
 
 /* local to this file */
 static int ColorQuoteSize;
@@ -462,16 +463,23 @@ static int _mutt_parse_uncolor (BUFFER *buf, BUFFER *s, unsigned long data,
 
   if (do_cache && !option (OPTNOCURSES))
   {
-    int i;
     set_option (OPTFORCEREDRAWINDEX);
-    /* force re-caching of index colors */
-    for (i = 0; Context && i < Context->msgcount; i++)
-      Context->hdrs[i]->pair = 0;
+    mutt_invalidate_index_colors ();
   }
   return (0);
 }
 
 
+/* Index colors are cached in each HEADER together with the generation
+ * of the color rules they were computed from.  Bumping the generation
+ * forces all of them to be re-evaluated the next time they are drawn.
+ */
+void mutt_invalidate_index_colors (void)
+{
+  if (!++ColorIndexGen)
+    ColorIndexGen = 1;
+}
+
 static int 
 add_pattern (COLOR_LINE **top, const char *s, int sensitive,
 	     int fg, int bg, int attr, BUFFER *err,
@@ -525,8 +533,6 @@ add_pattern (COLOR_LINE **top, const char *s, int sensitive,
     tmp = mutt_new_color_line ();
     if (is_index) 
     {
-      int i;
-
       strfcpy(buf, NONULL(s), sizeof(buf));
       mutt_check_simple (buf, sizeof (buf), NONULL(SimpleSearch));
       if((tmp->color_pattern = mutt_pattern_comp (buf, M_FULL_MSG, err)) == NULL)
@@ -534,9 +540,7 @@ add_pattern (COLOR_LINE **top, const char *s, int sensitive,
 	mutt_free_color_line(&tmp, 1);
 	return -1;
       }
-      /* force re-caching of index colors */
-      for (i = 0; Context && i < Context->msgcount; i++)
-	Context->hdrs[i]->pair = 0;
+      mutt_invalidate_index_colors ();
     }
     else if ((r = REGCOMP (&tmp->rx, s, (sensitive ? mutt_which_case (s) : REG_ICASE))) != 0)
     {
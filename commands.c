@@ -173,7 +173,7 @@ int mutt_display_message (HEADER *cur)
   
     /* Remove color cache for this message, in case there
        are color patterns for both ~g and ~V */
-    cur->pair = 0;
+    mutt_header_changed (cur);
   }
 
   if (builtin)
@@ -985,6 +985,7 @@ static int _mutt_check_traditional_pgp (HEADER *h, int *redraw)
   if (crypt_pgp_check_traditional (msg->fp, h->content, 0))
   {
     h->security = crypt_query (h->content);
+    mutt_header_changed (h);
     *redraw |= REDRAW_FULL;
     rv = 1;
   }
@@ -129,6 +129,29 @@ event_t mutt_getch (void)
   return (ch == ctrl ('G') ? err : ret);
 }
 
+/* Is there a key press waiting to be read?  Doesn't consume it. */
+int mutt_input_pending (void)
+{
+  return mutt_input_wait (0);
+}
+
+/* Like mutt_input_pending(), but wait up to ms milliseconds for one. */
+int mutt_input_wait (int ms)
+{
+  int ch;
+
+  if (UngetCount)
+    return 1;
+
+  timeout (ms);
+  ch = getch ();
+  timeout (-1);
+  if (ch == ERR)
+    return 0;
+  ungetch (ch);
+  return 1;
+}
+
 int _mutt_get_field (/* const */ char *field, char *buf, size_t buflen, int complete, int multiple, char ***files, int *numfiles)
 {
   int ret;
@@ -689,6 +712,20 @@ int mutt_addwch (wchar_t wc)
     return addstr (buf);
 }
 
+/*
+ * Returns the number of printable ASCII characters at the start of s
+ * (which is n bytes long).  Every charset we handle is a superset of
+ * ASCII and these characters are one cell wide, so they don't need to
+ * go through mbrtowc() and wcwidth().
+ */
+size_t mutt_ascii_run (const char *s, size_t n)
+{
+  size_t i;
+
+  for (i = 0; i < n && (unsigned char) s[i] >= 0x20 && (unsigned char) s[i] < 0x7f; i++)
+    ;
+  return i;
+}
 
 /*
  * This formats a string, a bit like
@@ -714,8 +751,25 @@ void mutt_format_string (char *dest, size_t destlen,
   memset(&mbstate2, 0, sizeof (mbstate2));
   --destlen;
   p = dest;
-  for (; n && (k = mbrtowc (&wc, s, n, &mbstate1)); s += k, n -= k)
+  for (; n; s += k, n -= k)
   {
+    if ((k = mutt_ascii_run (s, n)))
+    {
+      k2 = MIN (k, destlen);
+      if ((int) k2 > max_width)
+	k2 = max_width > 0 ? max_width : 0;
+      memcpy (p, s, k2);
+      p += k2;
+      destlen -= k2;
+      min_width -= k2;
+      max_width -= k2;
+      if (k2 < k)
+	break;
+      continue;
+    }
+
+    if (!(k = mbrtowc (&wc, s, n, &mbstate1)))
+      break;
     if (k == (size_t)(-1) || k == (size_t)(-2))
     {
       if (k == (size_t)(-1) && errno == EILSEQ)
@@ -853,8 +907,20 @@ void mutt_paddstr (int n, const char *s)
   mbstate_t mbstate;
 
   memset (&mbstate, 0, sizeof (mbstate));
-  for (; len && (k = mbrtowc (&wc, s, len, &mbstate)); s += k, len -= k)
+  for (; len; s += k, len -= k)
   {
+    if ((k = mutt_ascii_run (s, len)))
+    {
+      w = n > 0 ? MIN ((int) k, n) : 0;
+      addnstr ((char *)s, w);
+      n -= w;
+      if (w < (int) k)
+	break;
+      continue;
+    }
+
+    if (!(k = mbrtowc (&wc, s, len, &mbstate)))
+      break;
     if (k == (size_t)(-1) || k == (size_t)(-2))
     {
       if (k == (size_t) (-1))
@@ -892,8 +958,20 @@ int mutt_wstr_trunc (const char *src, size_t maxlen, size_t maxwid, size_t *widt
   n = mutt_strlen (src);
 
   memset (&mbstate, 0, sizeof (mbstate));
-  for (w = 0; n && (cl = mbrtowc (&wc, src, n, &mbstate)); src += cl, n -= cl)
+  for (w = 0; n; src += cl, n -= cl)
   {
+    if ((cl = mutt_ascii_run (src, n)))
+    {
+      cw = MIN (cl, MIN (maxlen - l, maxwid - w));
+      l += cw;
+      w += cw;
+      if (cw < cl)
+	break;
+      continue;
+    }
+
+    if (!(cl = mbrtowc (&wc, src, n, &mbstate)))
+      break;
     if (cl == (size_t)(-1) || cl == (size_t)(-2))
       cw = cl = 1;
     else
@@ -956,8 +1034,16 @@ int mutt_strwidth (const char *s)
   n = mutt_strlen (s);
 
   memset (&mbstate, 0, sizeof (mbstate));
-  for (w=0; n && (k = mbrtowc (&wc, s, n, &mbstate)); s += k, n -= k)
+  for (w=0; n; s += k, n -= k)
   {
+    if ((k = mutt_ascii_run (s, n)))
+    {
+      w += k;
+      continue;
+    }
+
+    if (!(k = mbrtowc (&wc, s, n, &mbstate)))
+      break;
     if (k == (size_t)(-1) || k == (size_t)(-2))
     {
       k = (k == (size_t)(-1)) ? 1 : n;
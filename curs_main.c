@@ -110,12 +110,48 @@ static const char *No_visible = N_("No visible messages.");
 
 extern size_t UngetCount;
 
+/* Formatted index entries are cached in the headers.  A cached entry is
+ * valid as long as its line_gen matches IndexLineGen, which is bumped
+ * whenever something all entries depend on may have changed: the
+ * configuration, the screen width, the thread tree or the numbering of
+ * the messages.  Changes to a single message reset its line_gen. */
+static unsigned int IndexLineGen = 1;
+
+void mutt_invalidate_index_lines (void)
+{
+  if (!++IndexLineGen)
+    IndexLineGen = 1;
+}
+
+/* can entries made with $index_format be cached at all? */
+static int index_line_cacheable (void)
+{
+  static unsigned int gen = 0;
+  static int cols = -1;
+  static int cacheable;
+
+  if (cols != COLS)
+  {
+    cols = COLS;
+    mutt_invalidate_index_lines ();
+  }
+  if (gen != IndexLineGen)
+  {
+    gen = IndexLineGen;
+    /* %<...> shows the current time */
+    cacheable = !strstr (NONULL (HdrFmt), "%<");
+  }
+
+  return cacheable;
+}
+
 void index_make_entry (char *s, size_t l, MUTTMENU *menu, int num)
 {
   format_flag flag = M_FORMAT_MAKEPRINT | M_FORMAT_ARROWCURSOR | M_FORMAT_INDEX;
   int edgemsgno, reverse = Sort & SORT_REVERSE;
   HEADER *h = Context->hdrs[Context->v2r[num]];
   THREAD *tmp;
+  int cache = index_line_cacheable ();
 
   if ((Sort & SORT_MASK) == SORT_THREADS && h->tree)
   {
@@ -169,14 +205,28 @@ void index_make_entry (char *s, size_t l, MUTTMENU *menu, int num)
     }
   }
 
+  if (cache && h->index_line && h->line_gen == IndexLineGen &&
+      h->line_flag == flag)
+  {
+    strfcpy (s, h->index_line, l);
+    return;
+  }
+
   _mutt_make_string (s, l, NONULL (HdrFmt), Context, h, flag);
+
+  if (cache)
+  {
+    mutt_str_replace (&h->index_line, s);
+    h->line_gen = IndexLineGen;
+    h->line_flag = flag;
+  }
 }
 
 int index_color (int index_no)
 {
   HEADER *h = Context->hdrs[Context->v2r[index_no]];
 
-  if (h && h->pair)
+  if (h && h->color_gen == ColorIndexGen)
     return h->pair;
 
   mutt_set_header_color (Context, h);
@@ -273,6 +323,8 @@ static void update_index (MUTTMENU *menu, CONTEXT *ctx, int check,
   HEADER  **save_new = NULL;
   int j;
 
+  mutt_invalidate_index_lines ();
+
   /* take note of the current message */
   if (oldcount)
   {
@@ -341,14 +393,9 @@ static void update_index (MUTTMENU *menu, CONTEXT *ctx, int check,
     {
       for (j = 0; j < ctx->msgcount - oldcount; j++)
       {
-	int k;
-
-	for (k = 0; k < ctx->msgcount; k++)
-	{
-	  HEADER *h = ctx->hdrs[k];
-	  if (h == save_new[j] && (!ctx->pattern || h->limited))
-	    mutt_uncollapse_thread (ctx, h);
-	}
+	HEADER *h = save_new[j];
+	if (!ctx->pattern || h->limited)
+	  mutt_uncollapse_thread (ctx, h);
       }
       FREE (&save_new);
       mutt_set_virtual (ctx);
@@ -401,6 +448,120 @@ static void resort_index (MUTTMENU *menu)
   menu->redraw = REDRAW_INDEX | REDRAW_STATUS;
 }
 
+/* read the next part of a mailbox which is being opened progressively, or
+ * all of the rest.  Sorting after every part would take quadratic time, so
+ * the messages are kept out of the index until the whole mailbox is read,
+ * and are then added to it like new mail.  Returns -2 if the mailbox is
+ * locked at the moment, see mx_open_more().
+ */
+static int read_more (MUTTMENU *menu, int all)
+{
+  int oldcount = Context->msgcount, first, quiet, rc, j;
+  int index_hint = (Context->vcount && menu->current >= 0 && menu->current < Context->vcount) ? CURHDR->index : 0;
+
+  if (all)
+    rc = mx_open_finish (Context);
+  else
+    rc = mx_open_more (Context);
+
+  if (rc == M_REOPENED || Context->msgcount < oldcount)
+  {
+    /* the file changed and everything was read again */
+    Context->hidden = 0;
+    update_index (menu, Context, M_REOPENED, oldcount, index_hint);
+    menu->max = Context->vcount;
+    set_option (OPTSEARCHINVALID);
+    mutt_error _("Mailbox was externally modified.  Flags may be wrong.");
+  }
+  else if (Context->loading)
+  {
+    /* mx_update_context() appended them to the index, take them out */
+    for (j = oldcount; j < Context->msgcount; j++)
+      Context->hdrs[j]->virtual = -1;
+    Context->vcount -= Context->msgcount - oldcount;
+    Context->hidden += Context->msgcount - oldcount;
+  }
+  else if (Context->hidden || Context->msgcount > oldcount)
+  {
+    first = oldcount - Context->hidden;
+    for (j = first; j < oldcount; j++)
+    {
+      Context->v2r[Context->vcount] = j;
+      Context->hdrs[j]->virtual = Context->vcount++;
+    }
+    Context->hidden = 0;
+
+    /* the hash tables were sized for the messages read first */
+    if (Context->id_hash)
+      hash_destroy (&Context->id_hash, NULL);
+    if (Context->subj_hash)
+      hash_destroy (&Context->subj_hash, NULL);
+    set_option (OPTRESORTINIT);
+
+    quiet = Context->quiet;
+    if (!all)
+      Context->quiet = 1;
+    update_index (menu, Context, M_NEW_MAIL, first, index_hint);
+    Context->quiet = quiet;
+    menu->max = Context->vcount;
+    set_option (OPTSEARCHINVALID);
+  }
+  menu->redraw |= REDRAW_INDEX | REDRAW_STATUS;
+  return rc;
+}
+
+/* does op have to see every message of the mailbox? */
+static int need_all_messages (int op)
+{
+  switch (op)
+  {
+    case OP_JUMP:
+    case OP_LAST_ENTRY:
+    case OP_MAIN_LIMIT:
+    case OP_MAIN_DELETE_PATTERN:
+    case OP_MAIN_TAG_PATTERN:
+    case OP_MAIN_UNDELETE_PATTERN:
+    case OP_MAIN_UNTAG_PATTERN:
+    case OP_SEARCH:
+    case OP_SEARCH_REVERSE:
+    case OP_SEARCH_NEXT:
+    case OP_SEARCH_OPPOSITE:
+    case OP_SORT:
+    case OP_SORT_REVERSE:
+    case OP_MAIN_SYNC_FOLDER:
+    case OP_MAIN_NEXT_NEW:
+    case OP_MAIN_NEXT_UNREAD:
+    case OP_MAIN_PREV_NEW:
+    case OP_MAIN_PREV_UNREAD:
+    case OP_MAIN_NEXT_NEW_THEN_UNREAD:
+    case OP_MAIN_PREV_NEW_THEN_UNREAD:
+    case OP_MAIN_COLLAPSE_ALL:
+      return 1;
+
+    /* the rest of a thread may not have been read yet */
+    case OP_DELETE_THREAD:
+    case OP_DELETE_SUBTHREAD:
+    case OP_UNDELETE_THREAD:
+    case OP_UNDELETE_SUBTHREAD:
+    case OP_TAG_THREAD:
+    case OP_TAG_SUBTHREAD:
+    case OP_MAIN_READ_THREAD:
+    case OP_MAIN_READ_SUBTHREAD:
+    case OP_MAIN_BREAK_THREAD:
+    case OP_MAIN_LINK_THREADS:
+      return 1;
+
+    /* closing the mailbox writes it back */
+    case OP_QUIT:
+    case OP_MAIN_CHANGE_FOLDER:
+    case OP_MAIN_NEXT_UNREAD_MAILBOX:
+    case OP_MAIN_CHANGE_FOLDER_READONLY:
+      return !Context->readonly && !Context->dontwrite;
+  }
+
+  return 0;
+}
+
 static struct mapping_t IndexHelp[] = {
   { N_("Quit"),  OP_QUIT },
   { N_("Del"),   OP_DELETE },
@@ -426,6 +587,7 @@ int mutt_index_menu (void)
   int newcount = -1;
   int oldcount = -1;
   int rc = -1;
+  int read_locked = 0;         /* mailbox was locked, wait before retrying */
   MUTTMENU *menu;
   char *cp;                    /* temporary variable. */
   int index_hint;   /* used to restore cursor position */
@@ -450,9 +612,11 @@ int mutt_index_menu (void)
 
     /* check if we need to resort the index because just about
      * any 'op' below could do mutt_enter_command(), either here or
-     * from any new menu launched, and change $sort/$sort_aux
+     * from any new menu launched, and change $sort/$sort_aux.  Messages
+     * kept out of the index while loading have to stay at the end.
      */
-    if (option (OPTNEEDRESORT) && Context && Context->msgcount && menu->current >= 0)
+    if (option (OPTNEEDRESORT) && Context && Context->msgcount && menu->current >= 0 &&
+	!Context->hidden)
       resort_index (menu);
 
     menu->max = Context ? Context->vcount : 0;
@@ -508,7 +672,11 @@ int mutt_index_menu (void)
 	/* avoid the message being overwritten by buffy */
 	do_buffy_notify = 0;
 
-	menu->redraw = REDRAW_FULL;
+	/* new mail only shifts the index, which is redrawn row by row */
+	if (check == M_NEW_MAIL)
+	  menu->redraw |= REDRAW_INDEX | REDRAW_STATUS;
+	else
+	  menu->redraw = REDRAW_FULL;
 	menu->max = Context->vcount;
 
 	set_option (OPTSEARCHINVALID);
@@ -600,6 +768,14 @@ int mutt_index_menu (void)
       }
 #endif
 
+      /* read on while the user isn't doing anything */
+      if (Context && Context->loading &&
+	  !(read_locked ? mutt_input_wait (1000) : mutt_input_pending ()))
+      {
+	read_locked = (read_more (menu, 0) == -2);
+	continue;
+      }
+
       op = km_dokey (MENU_MAIN);
 
       dprint(4, (debugfile, "mutt_index_menu[%d]: Got op %d\n", __LINE__, op));
@@ -690,6 +866,9 @@ int mutt_index_menu (void)
     imap_disallow_reopen (Context);
 #endif
 
+    if (Context && Context->loading && need_all_messages (op))
+      read_more (menu, 1);
+
     switch (op)
     {
 
@@ -1145,8 +1324,8 @@ int mutt_index_menu (void)
 	mutt_folder_hook (buf);
 
 	if ((Context = mx_open_mailbox (buf,
-					(option (OPTREADONLY) || op == OP_MAIN_CHANGE_FOLDER_READONLY) ?
-					M_READONLY : 0, NULL)) != NULL)
+					((option (OPTREADONLY) || op == OP_MAIN_CHANGE_FOLDER_READONLY) ?
+					 M_READONLY : 0) | M_PROGRESSIVE, NULL)) != NULL)
 	{
 	  menu->current = ci_first_message ();
 	}
@@ -1177,7 +1356,7 @@ int mutt_index_menu (void)
 	if ((Sort & SORT_MASK) == SORT_THREADS && CURHDR->collapsed)
 	{
 	  mutt_uncollapse_thread (Context, CURHDR);
-	  mutt_set_virtual (Context);
+	  mutt_set_virtual_thread (Context, CURHDR);
 	  if (option (OPTUNCOLLAPSEJUMP))
 	    menu->current = mutt_thread_next_unread (Context, CURHDR);
 	}
@@ -1709,14 +1888,14 @@ int mutt_index_menu (void)
 	if (CURHDR->collapsed)
 	{
 	  menu->current = mutt_uncollapse_thread (Context, CURHDR);
-	  mutt_set_virtual (Context);
+	  mutt_set_virtual_thread (Context, CURHDR);
 	  if (option (OPTUNCOLLAPSEJUMP))
 	    menu->current = mutt_thread_next_unread (Context, CURHDR);
 	}
 	else if (option (OPTCOLLAPSEUNREAD) || !UNREAD (CURHDR))
 	{
 	  menu->current = mutt_collapse_thread (Context, CURHDR);
-	  mutt_set_virtual (Context);
+	  mutt_set_virtual_thread (Context, CURHDR);
 	}
 	else
 	{
@@ -2221,7 +2400,9 @@ void mutt_set_header_color (CONTEXT *ctx, HEADER *curhdr)
    if (mutt_pattern_exec (color->color_pattern, M_MATCH_FULL_ADDRESS, ctx, curhdr))
    {
       curhdr->pair = color->pair;
+      curhdr->color_gen = ColorIndexGen;
       return;
    }
   curhdr->pair = ColorDefs[MT_COLOR_NORMAL];
+  curhdr->color_gen = ColorIndexGen;
 }
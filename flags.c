@@ -25,12 +25,22 @@
 #include "sort.h"
 #include "mx.h"
 
+/* h's flags or contents changed behind _mutt_set_flag()'s back, or in it:
+ * its index line, color and score have to be worked out again */
+void mutt_header_changed (HEADER *h)
+{
+  h->color_gen = 0;
+  h->line_gen = 0;
+  h->score_stale = 1;
+}
+
 void _mutt_set_flag (CONTEXT *ctx, HEADER *h, int flag, int bf, int upd_ctx)
 {
   int changed = h->changed;
   int deleted = ctx->deleted;
   int tagged = ctx->tagged;
   int flagged = ctx->flagged;
+  int read = h->read, old = h->old;
   int update = 0;
 
   if (ctx->readonly && flag != M_TAG)
@@ -254,8 +264,13 @@ void _mutt_set_flag (CONTEXT *ctx, HEADER *h, int flag, int bf, int upd_ctx)
       break;
   }
 
+  /* re-evaluate the index color and entry lazily, the next time they
+   * are drawn */
   if (update)
-    mutt_set_header_color(ctx, h);
+    mutt_header_changed (h);
+
+  if (read != h->read || old != h->old)
+    mutt_thread_update_counts (ctx, h, read, old);
 
   /* if the message status has changed, we need to invalidate the cached
    * search results so that any future search will match the current status
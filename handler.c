@@ -93,7 +93,7 @@ static void mutt_convert_to_state(iconv_t cd, char *bufi, size_t *l, STATE *s)
     return;
   }
 
-  if (cd == (iconv_t)(-1))
+  if (cd == (iconv_t)(-1) || mutt_iconv_passthrough (cd, bufi, *l))
   {
     state_prefix_put (bufi, *l, s);
     *l = 0;
@@ -172,7 +172,7 @@ static int qp_decode_triple (char *s, char *d)
 static void qp_decode_line (char *dest, char *src, size_t *l,
 			    int last)
 {
-  char *d, *s;
+  char *d, *s, *e;
   char c = 0;
 
   int kind = -1;
@@ -182,6 +182,18 @@ static void qp_decode_line (char *dest, char *src, size_t *l,
   
   for (d = dest, s = src; *s;)
   {
+    /* copy everything up to the next '=' in one go */
+    if (*s != '=')
+    {
+      if (!(e = strchr (s, '=')))
+	e = s + strlen (s);
+      memcpy (d, s, e - s);
+      d += e - s;
+      s = e;
+      kind = -1;
+      continue;
+    }
+
     switch ((kind = qp_decode_triple (s, &c)))
     {
       case  0: *d++ = c; s += 3; break;	/* qp triple */
@@ -225,14 +237,16 @@ static void qp_decode_line (char *dest, char *src, size_t *l,
  * memory to store the decoded data.
  * 
  * Just to make sure that I didn't make some off-by-one error
- * above, we just use STRING*2 for the target buffer's size.
+ * above, we just use STRING*2 for the target buffer's size.  On
+ * top of that, the decoded lines are collected until there are
+ * BUFI_SIZE bytes of them, so we add that much.
  * 
  */
 
 static void mutt_decode_quoted (STATE *s, long len, int istext, iconv_t cd)
 {
   char line[STRING];
-  char decline[2*STRING];
+  char decline[BUFI_SIZE + 2*STRING];
   size_t l = 0;
   size_t linelen;      /* number of input bytes in `line' */
   size_t l3;
@@ -276,9 +290,12 @@ static void mutt_decode_quoted (STATE *s, long len, int istext, iconv_t cd)
     /* decode and do character set conversion */
     qp_decode_line (decline + l, line, &l3, last);
     l += l3;
-    mutt_convert_to_state (cd, decline, &l, s);
+    /* collect a few lines before handing them on */
+    if (l >= BUFI_SIZE)
+      mutt_convert_to_state (cd, decline, &l, s);
   }
 
+  mutt_convert_to_state (cd, decline, &l, s);
   mutt_convert_to_state (cd, 0, 0, s);
   state_reset_prefix(s);
 }
@@ -288,20 +305,30 @@ void mutt_decode_base64 (STATE *s, long len, int istext, iconv_t cd)
   char buf[5];
   int c1, c2, c3, c4, ch, cr = 0, i;
   char bufi[BUFI_SIZE];
-  size_t l = 0;
+  unsigned char bufb[BUFI_SIZE];	/* undecoded input */
+  size_t l = 0, n = 0, pos = 0;
 
   buf[4] = 0;
 
   if (istext) 
     state_set_prefix(s);
 
-  while (len > 0)
+  /* the input is read in blocks of up to len bytes, and the quads are
+   * gathered from memory instead of one fgetc() per character */
+  while (len > 0 || pos < n)
   {
-    for (i = 0 ; i < 4 && len > 0 ; len--)
+    for (i = 0 ; i < 4 ; )
     {
-      if ((ch = fgetc (s->fpin)) == EOF)
-	break;
-      if (ch >= 0 && ch < 128 && (base64val(ch) != -1 || ch == '='))
+      if (pos == n)
+      {
+	if (len <= 0
+	    || !(n = fread (bufb, 1, MIN ((size_t) len, sizeof (bufb)), s->fpin)))
+	  break;
+	len -= n;
+	pos = 0;
+      }
+      ch = bufb[pos++];
+      if (ch < 128 && (base64val(ch) != -1 || ch == '='))
 	buf[i++] = ch;
     }
     if (i != 4)
@@ -357,6 +384,10 @@ void mutt_decode_base64 (STATE *s, long len, int istext, iconv_t cd)
       mutt_convert_to_state (cd, bufi, &l, s);
   }
 
+  /* leave the input behind the padding, as if we had read it bytewise */
+  if (pos < n)
+    fseeko (s->fpin, -(LOFF_T) (n - pos), SEEK_CUR);
+
   if (cr) bufi[l++] = '\r';
 
   mutt_convert_to_state (cd, bufi, &l, s);
@@ -1483,7 +1514,7 @@ void mutt_decode_attachment (BODY *b, STATE *s)
   }
 
   if (cd != (iconv_t)(-1))
-    iconv_close (cd);
+    mutt_iconv_close (cd);
 }
 
 /* when generating format=flowed ($text_flowed is set) from format=fixed,
@@ -53,6 +53,9 @@ static struct header_cache
   VILLA *db;
   char *folder;
   unsigned int crc;
+  struct header_cache *msgid;	/* Message-ID index, if in use */
+  LIST *msgid_pending;		/* entries to add to it on close */
+  unsigned int msgid_dirty : 1;	/* the folder says the index is stale */
 } HEADER_CACHE;
 #elif HAVE_TC
 static struct header_cache
@@ -60,6 +63,9 @@ static struct header_cache
   TCBDB *db;
   char *folder;
   unsigned int crc;
+  struct header_cache *msgid;	/* Message-ID index, if in use */
+  LIST *msgid_pending;		/* entries to add to it on close */
+  unsigned int msgid_dirty : 1;	/* the folder says the index is stale */
 } HEADER_CACHE;
 #elif HAVE_GDBM
 static struct header_cache
@@ -67,6 +73,9 @@ static struct header_cache
   GDBM_FILE db;
   char *folder;
   unsigned int crc;
+  struct header_cache *msgid;	/* Message-ID index, if in use */
+  LIST *msgid_pending;		/* entries to add to it on close */
+  unsigned int msgid_dirty : 1;	/* the folder says the index is stale */
 } HEADER_CACHE;
 #elif HAVE_DB4
 static struct header_cache
@@ -75,6 +84,9 @@ static struct header_cache
   DB *db;
   char *folder;
   unsigned int crc;
+  struct header_cache *msgid;	/* Message-ID index, if in use */
+  LIST *msgid_pending;		/* entries to add to it on close */
+  unsigned int msgid_dirty : 1;	/* the folder says the index is stale */
   int fd;
   char lockfile[_POSIX_PATH_MAX];
 } HEADER_CACHE;
@@ -89,6 +101,19 @@ typedef union
   unsigned int uidvalidity;
 } validate;
 
+/* folder name and file name of the Message-ID index */
+#define MSGID_INDEX_FOLDER "mutt:message-id-index"
+#define MSGID_INDEX_FILE "message-id-index"
+
+/* key of the record telling which index update a folder's cache matches */
+#define MSGID_INDEX_SYNC "/MSGIDINDEX"
+
+static void msgid_index_open (header_cache_t *h);
+static void msgid_index_close (header_cache_t *h);
+static void msgid_index_store (header_cache_t *h, HEADER *header,
+			       const char *filename,
+			       size_t (*keylen) (const char *fn));
+
 static void *
 lazy_malloc(size_t siz)
 {
@@ -483,6 +508,48 @@ restore_envelope(ENVELOPE * e, const unsigned char *d, int *off, int convert)
   restore_list(&e->userhdrs, d, off, convert);
 }
 
+/* The following helpers walk a dumped header without allocating
+ * anything.  len is the size of the record, they return -1 if the record
+ * turns out to be shorter than its contents claim. */
+static int
+skip_char(const unsigned char *d, int *off, int len)
+{
+  unsigned int size;
+
+  if (*off + (int) sizeof (int) > len)
+    return -1;
+  restore_int(&size, d, off);
+  if (size > (unsigned int) (len - *off))
+    return -1;
+  *off += size;
+
+  return 0;
+}
+
+static int
+skip_address(const unsigned char *d, int *off, int len)
+{
+  unsigned int counter;
+
+  if (*off + (int) sizeof (int) > len)
+    return -1;
+  restore_int(&counter, d, off);
+
+  while (counter--)
+  {
+#ifdef EXACT_ADDRESS
+    if (skip_char(d, off, len) < 0)
+      return -1;
+#endif
+    if (skip_char(d, off, len) < 0 || skip_char(d, off, len) < 0 ||
+	*off + (int) sizeof (int) > len)
+      return -1;
+    *off += sizeof (int);
+  }
+
+  return 0;
+}
+
 static int
 crc_matches(const char *d, unsigned int crc)
 {
@@ -625,7 +692,12 @@ mutt_hcache_dump(header_cache_t *h, HEADER * header, int *off,
   nh.num_hidden = 0;
   nh.recipient = 0;
   nh.pair = 0;
+  nh.color_gen = 0;
+  nh.index_line = NULL;
+  nh.line_gen = 0;
+  nh.score_gen = 0;
   nh.attach_valid = 0;
+  nh.summary_changed = 0;
   nh.path = NULL;
   nh.tree = NULL;
   nh.thread = NULL;
@@ -642,10 +714,42 @@ mutt_hcache_dump(header_cache_t *h, HEADER * header, int *off,
   d = dump_envelope(nh.env, d, off, convert);
   d = dump_body(nh.content, d, off, convert);
   d = dump_char(nh.maildir_flags, d, off, convert);
+  d = dump_char(nh.mime_summary, d, off, 0);
 
   return d;
 }
 
+/* Find the Message-ID of a dumped header without restoring it.  Returns a
+ * pointer into d, or NULL if d isn't a header of this cache version. */
+static const char *
+peek_message_id(const unsigned char *d, int len, unsigned int crc)
+{
+  int off = sizeof (validate) + sizeof (unsigned int) + sizeof (HEADER);
+  unsigned int size;
+  int i;
+
+  if (len < off || !crc_matches((const char *) d, crc))
+    return NULL;
+
+  /* return_path, from, to, cc, bcc, sender, reply_to, mail_followup_to */
+  for (i = 0; i < 8; i++)
+    if (skip_address(d, &off, len) < 0)
+      return NULL;
+
+  /* list_post, subject and real_subj */
+  if (skip_char(d, &off, len) < 0 || skip_char(d, &off, len) < 0)
+    return NULL;
+  off += sizeof (int);
+
+  if (off + (int) sizeof (int) > len)
+    return NULL;
+  restore_int(&size, d, &off);
+  if (!size || size > (unsigned int) (len - off) || d[off + size - 1])
+    return NULL;
+
+  return (const char *) d + off;
+}
+
 HEADER *
 mutt_hcache_restore(const unsigned char *d, HEADER ** oh)
 {
@@ -664,11 +768,14 @@ mutt_hcache_restore(const unsigned char *d, HEADER ** oh)
 
   h->env = mutt_new_envelope();
   restore_envelope(h->env, d, &off, convert);
+  if (option (OPTINTERNSTRINGS))
+    mutt_intern_envelope(h->env);
 
   h->content = mutt_new_body();
   restore_body(h->content, d, &off, convert);
 
   restore_char(&h->maildir_flags, d, &off, convert);
+  restore_char(&h->mime_summary, d, &off, 0);
 
   /* this is needed for maildir style mailboxes */
   if (oh)
@@ -773,6 +880,9 @@ mutt_hcache_store(header_cache_t *h, const char *filename, HEADER * header,
   ret = mutt_hcache_store_raw (h, filename, data, dlen, keylen);
   
   FREE(&data);
+
+  if (ret == 0)
+    msgid_index_store (h, header, filename, keylen);
   
   return ret;
 }
@@ -873,6 +983,7 @@ mutt_hcache_close(header_cache_t *h)
   if (!h)
     return;
 
+  msgid_index_close(h);
   vlclose(h->db);
   FREE(&h->folder);
   FREE(&h);
@@ -918,6 +1029,7 @@ mutt_hcache_close(header_cache_t *h)
   if (!h)
     return;
 
+  msgid_index_close(h);
   tcbdbclose(h->db);
   tcbdbdel(h->db);
   FREE(&h->folder);
@@ -969,6 +1081,7 @@ mutt_hcache_close(header_cache_t *h)
   if (!h)
     return;
 
+  msgid_index_close(h);
   gdbm_close(h->db);
   FREE(&h->folder);
   FREE(&h);
@@ -1076,6 +1189,7 @@ mutt_hcache_close(header_cache_t *h)
   if (!h)
     return;
 
+  msgid_index_close(h);
   h->db->close (h->db, 0);
   h->env->close (h->env, 0);
   mx_unlock_file (h->lockfile, h->fd, 0);
@@ -1133,14 +1247,20 @@ mutt_hcache_open(const char *path, const char *folder, hcache_namer_t namer)
   path = mutt_hcache_per_folder(path, h->folder, namer);
 
   if (!hcache_open (h, path))
+  {
+    msgid_index_open (h);
     return h;
+  }
   else
   {
     /* remove a possibly incompatible version */
     if (!stat (path, &sb) && !unlink (path))
     {
       if (!hcache_open (h, path))
+      {
+        msgid_index_open (h);
         return h;
+      }
     }
     FREE(&h->folder);
     FREE(&h);
@@ -1149,6 +1269,370 @@ mutt_hcache_open(const char *path, const char *folder, hcache_namer_t namer)
   }
 }
 
+/*
+ * The Message-ID index maps the Message-ID of every header cached message
+ * to the folders and cache keys it was seen with, so that messages can be
+ * found without opening the folders holding them.  It lives in its own
+ * database in the $header_cache directory.  Headers stored while a cache
+ * is open are added to it in one go when the cache is closed.  Records
+ * are lists of NUL terminated folder and key strings, terminated by an
+ * empty folder name.  Entries are never removed when a message goes
+ * away, so users of the index must be prepared to find stale ones.
+ *
+ * Each folder's cache and the index keep a generation of the last update
+ * of the index from that folder, in the MSGID_INDEX_SYNC record and the
+ * folder's marker record.  While a cache is open, or once headers were
+ * stored with the index turned off, the folder's generation is "0".  A
+ * folder whose generations differ is streamed into the index again the
+ * next time it is opened.
+ */
+
+static int msgid_index_namer (const char *path, char *dest, size_t dlen)
+{
+  return snprintf (dest, dlen, "%s", MSGID_INDEX_FILE);
+}
+
+static size_t msgid_index_keylen (const char *fn)
+{
+  return mutt_strlen (fn);
+}
+
+/* The index is shared by all open header caches, since most backends
+ * lock their database files against a second writer. */
+static header_cache_t *MsgIdIndex = NULL;
+static int MsgIdIndexRefs = 0;
+
+/* set while the index itself is being opened, which mustn't open it again.
+ * Its folder name can't tell: get_foldername() may have resolved it. */
+static int MsgIdIndexOpening = 0;
+
+static header_cache_t *msgid_index_acquire (void)
+{
+  struct stat sb;
+
+  if (MsgIdIndex)
+  {
+    MsgIdIndexRefs++;
+    return MsgIdIndex;
+  }
+
+  /* a single global header cache file can't hold a second database */
+  if (!option (OPTHCACHEMSGID) || !HeaderCache ||
+      stat (HeaderCache, &sb) < 0 || !S_ISDIR (sb.st_mode))
+    return NULL;
+
+  MsgIdIndexOpening = 1;
+  if ((MsgIdIndex = mutt_hcache_open (HeaderCache, MSGID_INDEX_FOLDER,
+				      msgid_index_namer)))
+    MsgIdIndexRefs = 1;
+  MsgIdIndexOpening = 0;
+  return MsgIdIndex;
+}
+
+static void msgid_index_release (header_cache_t *idx)
+{
+  if (!idx || idx != MsgIdIndex || --MsgIdIndexRefs > 0)
+    return;
+
+  MsgIdIndex = NULL;
+  mutt_hcache_close (idx);
+}
+
+static void msgid_index_add (header_cache_t *idx, const char *msgid,
+			     const char *folder, const char *key)
+{
+  char *old, *p, *data;
+  size_t olen = 0, flen, klen;
+
+  if (!msgid || !*msgid)
+    return;
+
+  if ((old = mutt_hcache_fetch_raw (idx, msgid, msgid_index_keylen)))
+  {
+    for (p = old; *p; p += mutt_strlen (p) + 1)
+    {
+      if (!mutt_strcmp (p, folder) && !mutt_strcmp (p + mutt_strlen (p) + 1, key))
+      {
+	FREE (&old);
+	return;
+      }
+      p += mutt_strlen (p) + 1;
+    }
+    olen = p - old;
+  }
+
+  flen = mutt_strlen (folder) + 1;
+  klen = mutt_strlen (key) + 1;
+  data = safe_malloc (olen + flen + klen + 1);
+  if (olen)
+    memcpy (data, old, olen);
+  memcpy (data + olen, folder, flen);
+  memcpy (data + olen + flen, key, klen);
+  data[olen + flen + klen] = 0;
+
+  mutt_hcache_store_raw (idx, msgid, data, olen + flen + klen + 1,
+			 msgid_index_keylen);
+
+  FREE (&data);
+  FREE (&old);
+}
+
+/* mark h's folder as not matching the index */
+static void msgid_index_dirty (header_cache_t *h)
+{
+  if (h->msgid_dirty)
+    return;
+  mutt_hcache_store_raw (h, MSGID_INDEX_SYNC, "0", 2, mutt_strlen);
+  h->msgid_dirty = 1;
+}
+
+/* queue the index entry for a header being stored in h */
+static void msgid_index_store (header_cache_t *h, HEADER *header,
+			       const char *filename,
+			       size_t (*keylen) (const char *fn))
+{
+  LIST *entry;
+  size_t mlen, klen;
+
+  if (!h->msgid)
+  {
+    /* the index will have to stream this folder again */
+    msgid_index_dirty (h);
+    return;
+  }
+
+  if (!header->env || !header->env->message_id)
+    return;
+
+#if HAVE_DB4
+  if (filename[0] == '/')
+    filename++;
+#endif
+  mlen = mutt_strlen (header->env->message_id) + 1;
+  klen = keylen (filename);
+
+  /* the Message-ID and the key, as one string each */
+  entry = safe_calloc (1, sizeof (LIST));
+  entry->data = safe_malloc (mlen + klen + 1);
+  memcpy (entry->data, header->env->message_id, mlen);
+  memcpy (entry->data + mlen, filename, klen);
+  entry->data[mlen + klen] = 0;
+  entry->next = h->msgid_pending;
+  h->msgid_pending = entry;
+}
+
+/* add a record of h's database to the index, keys include the folder
+ * name except for DB4, which keeps one database per folder */
+static void msgid_index_record (header_cache_t *h, const char *k, int klen,
+				const void *d, int dlen)
+{
+  const char *msgid;
+  char *key;
+#if !HAVE_DB4
+  int plen = mutt_strlen (h->folder);
+
+  if (klen < plen || strncmp (k, h->folder, plen))
+    return;
+  k += plen;
+  klen -= plen;
+#endif
+
+  if (!(msgid = peek_message_id (d, dlen, h->crc)))
+    return;
+
+  key = mutt_substrdup (k, k + klen);
+  msgid_index_add (h->msgid, msgid, h->folder, key);
+  FREE (&key);
+}
+
+/* stream all headers of h's folder into the index */
+static void msgid_index_build (header_cache_t *h)
+{
+#if HAVE_QDBM
+  char *k, *d;
+  int klen, dlen;
+
+  if (!vlcurjump (h->db, h->folder, mutt_strlen (h->folder), VL_JFORWARD))
+    return;
+  while ((k = vlcurkey (h->db, &klen)) != NULL)
+  {
+    if (klen < mutt_strlen (h->folder) ||
+	strncmp (k, h->folder, mutt_strlen (h->folder)))
+    {
+      FREE (&k);
+      break;
+    }
+    if ((d = vlcurval (h->db, &dlen)) != NULL)
+      msgid_index_record (h, k, klen, d, dlen);
+    FREE (&k);
+    FREE (&d);
+    if (!vlcurnext (h->db))
+      break;
+  }
+#elif HAVE_TC
+  BDBCUR *cur;
+  char *k, *d;
+  int klen, dlen;
+
+  cur = tcbdbcurnew (h->db);
+  if (tcbdbcurjump (cur, h->folder, mutt_strlen (h->folder)))
+  {
+    while ((k = tcbdbcurkey (cur, &klen)) != NULL)
+    {
+      if (klen < mutt_strlen (h->folder) ||
+	  strncmp (k, h->folder, mutt_strlen (h->folder)))
+      {
+	FREE (&k);
+	break;
+      }
+      if ((d = tcbdbcurval (cur, &dlen)) != NULL)
+	msgid_index_record (h, k, klen, d, dlen);
+      FREE (&k);
+      FREE (&d);
+      if (!tcbdbcurnext (cur))
+	break;
+    }
+  }
+  tcbdbcurdel (cur);
+#elif HAVE_GDBM
+  datum key, next, data;
+
+  key = gdbm_firstkey (h->db);
+  while (key.dptr)
+  {
+    data = gdbm_fetch (h->db, key);
+    if (data.dptr)
+      msgid_index_record (h, key.dptr, key.dsize, data.dptr, data.dsize);
+    FREE (&data.dptr);
+    next = gdbm_nextkey (h->db, key);
+    FREE (&key.dptr);
+    key = next;
+  }
+#elif HAVE_DB4
+  DBC *cursor;
+  DBT key, data;
+
+  if (h->db->cursor (h->db, NULL, &cursor, 0))
+    return;
+  mutt_hcache_dbt_empty_init (&key);
+  mutt_hcache_dbt_empty_init (&data);
+  while (cursor->c_get (cursor, &key, &data, DB_NEXT) == 0)
+    msgid_index_record (h, key.data, key.size, data.data, data.size);
+  cursor->c_close (cursor);
+#endif
+}
+
+/* open the index for h, streaming the headers cached so far into it if
+ * the index doesn't match them */
+static void msgid_index_open (header_cache_t *h)
+{
+  char marker[_POSIX_PATH_MAX];
+  char *gen, *igen;
+
+  if (MsgIdIndexOpening)
+  {
+    /* this is the index itself */
+    h->msgid_dirty = 1;
+    return;
+  }
+  if (!(h->msgid = msgid_index_acquire ()))
+    return;
+
+  /* Message-IDs are enclosed in <>, so this can't clash with one */
+  snprintf (marker, sizeof (marker), "\001%s", h->folder);
+  gen = mutt_hcache_fetch_raw (h, MSGID_INDEX_SYNC, mutt_strlen);
+  igen = mutt_hcache_fetch_raw (h->msgid, marker, msgid_index_keylen);
+  if (!gen || !igen || !*gen || !strcmp (gen, "0") || strcmp (gen, igen))
+    msgid_index_build (h);
+  FREE (&gen);
+  FREE (&igen);
+
+  /* until msgid_index_close() brings the index up to date */
+  msgid_index_dirty (h);
+}
+
+/* add the entries queued by msgid_index_store() to the index, record the
+ * new generation on both sides and release the index */
+static void msgid_index_close (header_cache_t *h)
+{
+  char marker[_POSIX_PATH_MAX], gen[STRING];
+  static unsigned int count = 0;
+  LIST *entry;
+
+  if (!h->msgid)
+    return;
+
+  for (entry = h->msgid_pending; entry; entry = entry->next)
+    msgid_index_add (h->msgid, entry->data, h->folder,
+		     entry->data + mutt_strlen (entry->data) + 1);
+  mutt_free_list (&h->msgid_pending);
+
+  snprintf (marker, sizeof (marker), "\001%s", h->folder);
+  snprintf (gen, sizeof (gen), "%ld.%d.%u", (long) time (NULL),
+	    (int) getpid (), ++count);
+  if (mutt_hcache_store_raw (h->msgid, marker, gen, mutt_strlen (gen) + 1,
+			     msgid_index_keylen) == 0)
+    mutt_hcache_store_raw (h, MSGID_INDEX_SYNC, gen, mutt_strlen (gen) + 1,
+			   mutt_strlen);
+
+  msgid_index_release (h->msgid);
+  h->msgid = NULL;
+}
+
+/*
+ * Look up msgid in the Message-ID index.  The name of the first folder
+ * other than exclude which contains it is copied to folder.  Returns 0 if
+ * such a folder was found, -1 otherwise.
+ */
+int mutt_hcache_msgid_lookup (const char *msgid, const char *exclude,
+			      char *folder, size_t flen)
+{
+  header_cache_t *idx;
+  char *data, *p, *ex;
+  int rc = -1;
+
+  if (!msgid || !(idx = msgid_index_acquire ()))
+    return -1;
+
+  ex = exclude ? get_foldername (exclude) : NULL;
+  if ((data = mutt_hcache_fetch_raw (idx, msgid, msgid_index_keylen)))
+  {
+    for (p = data; *p; p += mutt_strlen (p) + 1)
+    {
+      if (mutt_strcmp (p, ex))
+      {
+	strfcpy (folder, p, flen);
+	rc = 0;
+	break;
+      }
+      p += mutt_strlen (p) + 1;
+    }
+    FREE (&data);
+  }
+
+  FREE (&ex);
+  msgid_index_release (idx);
+  return rc;
+}
+
+/* index kept open by mutt_hcache_msgid_hold() */
+static header_cache_t *MsgIdIndexHeld = NULL;
+
+/*
+ * Keep the Message-ID index open while hold is set, so that callers
+ * looking up many messages don't reopen it for each of them.
+ */
+void mutt_hcache_msgid_hold (int hold)
+{
+  if (hold && !MsgIdIndexHeld)
+    MsgIdIndexHeld = msgid_index_acquire ();
+  else if (!hold && MsgIdIndexHeld)
+  {
+    msgid_index_release (MsgIdIndexHeld);
+    MsgIdIndexHeld = NULL;
+  }
+}
+
 #if HAVE_DB4
 const char *mutt_hcache_backend (void)
 {
@@ -40,6 +40,10 @@ int mutt_hcache_store_raw (header_cache_t *h, const char* filename, void* data,
                            size_t dlen, size_t(*keylen) (const char* fn));
 int mutt_hcache_delete(header_cache_t *h, const char *filename, size_t (*keylen)(const char *fn));
 
+int mutt_hcache_msgid_lookup (const char *msgid, const char *exclude,
+			      char *folder, size_t flen);
+void mutt_hcache_msgid_hold (int hold);
+
 const char *mutt_hcache_backend (void);
 
 #endif /* _HCACHE_H_ */
@@ -1328,6 +1328,34 @@ int imap_sync_mailbox (CONTEXT* ctx, int expunge, int* index_hint)
 }
 
 /* imap_close_mailbox: clean up IMAP data in CONTEXT */
+#if USE_HCACHE
+/* store the MIME summaries worked out during this session, so that
+ * attachment counts don't need the messages fetched next time */
+static void imap_store_summaries (IMAP_DATA* idata)
+{
+  CONTEXT* ctx = idata->ctx;
+  HEADER* h;
+  int i;
+
+  for (i = 0; i < ctx->msgcount; i++)
+  {
+    h = ctx->hdrs[i];
+    /* mailbox may not have fully loaded, and expunged or deleted
+     * messages may just have been removed from the cache */
+    if (!h || !h->data || !h->summary_changed || !h->active || h->deleted)
+      continue;
+
+    if (!idata->hcache && !(idata->hcache = imap_hcache_open (idata, NULL)))
+      return;
+
+    imap_hcache_put (idata, h);
+    h->summary_changed = 0;
+  }
+
+  imap_hcache_close (idata);
+}
+#endif
+
 int imap_close_mailbox (CONTEXT* ctx)
 {
   IMAP_DATA* idata;
@@ -1340,6 +1368,10 @@ int imap_close_mailbox (CONTEXT* ctx)
 
   if (ctx == idata->ctx)
   {
+#if USE_HCACHE
+    imap_store_summaries (idata);
+#endif
+
     if (idata->status != IMAP_FATAL && idata->state >= IMAP_SELECTED)
     {
       /* mx_close_mailbox won't sync if there are no deleted messages
@@ -396,7 +396,7 @@ int imap_fetch_message (MESSAGE *msg, CONTEXT *ctx, int msgno)
   int uid;
   int cacheno;
   IMAP_CACHE *cache;
-  int read;
+  int read, old;
   int rc;
   /* Sam's weird courier server returns an OK response even when FETCH
    * fails. Thanks Sam. */
@@ -543,16 +543,22 @@ int imap_fetch_message (MESSAGE *msg, CONTEXT *ctx, int msgno)
    * picked up in mutt_read_rfc822_header, we mark the message (and context
    * changed). Another possiblity: ignore Status on IMAP?*/
   read = h->read;
+  old = h->old;
   newenv = mutt_read_rfc822_header (msg->fp, h, 0, 0);
   mutt_merge_envelopes(h->env, &newenv);
 
   /* see above. We want the new status in h->read, so we unset it manually
-   * and let mutt_set_flag set it correctly, updating context. */
+   * and let mutt_set_flag set it correctly, updating context.  Status may
+   * have changed h->old as well, which the thread counts must see before
+   * mutt_set_flag() adjusts them. */
   if (read != h->read)
   {
     h->read = read;
+    mutt_thread_update_counts (ctx, h, read, old);
     mutt_set_flag (ctx, h, M_NEW, read);
   }
+  else
+    mutt_thread_update_counts (ctx, h, read, old);
 
   h->lines = 0;
   fgets (buf, sizeof (buf), msg->fp);
@@ -569,6 +575,10 @@ int imap_fetch_message (MESSAGE *msg, CONTEXT *ctx, int msgno)
   h->security = crypt_query (h->content);
 #endif
 
+  /* the full headers and line count may change the index entry, color
+   * and score */
+  mutt_header_changed (h);
+
   mutt_clear_error();
   rewind (msg->fp);
   HEADER_DATA(h)->parsed = 1;
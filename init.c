@@ -2324,6 +2324,9 @@ int mutt_parse_rc_line (/* const */ char *line, BUFFER *token, BUFFER *err)
   if (!line || !*line)
     return 0;
 
+  /* most commands can change what index entries look like */
+  mutt_invalidate_index_lines ();
+
   memset (&expn, 0, sizeof (expn));
   expn.data = expn.dptr = line;
   expn.dsize = mutt_strlen (line);
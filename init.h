@@ -922,6 +922,21 @@ struct option_t MuttVars[] = {
   ** much faster than opening non header cached folders.
   */
 #endif /* HAVE_QDBM */
+  { "header_cache_msgid_index", DT_BOOL, R_NONE, OPTHCACHEMSGID, 0 },
+  /*
+  ** .pp
+  ** When \fIset\fP and ``$$header_cache'' points to a directory, Mutt
+  ** keeps an additional database there which records the folder of every
+  ** message it has cached the headers of, indexed by Message-ID.  The
+  ** index is built the first time a folder is opened and brought up to
+  ** date with the headers cached while a folder was open when it is
+  ** closed.  When the parent of a message isn't in the current folder,
+  ** \fI<parent-message>\fP uses it to tell you which folder the parent
+  ** is in, and the ``~='' pattern also matches messages that have a copy
+  ** in another folder.  Since messages aren't removed from the index when
+  ** they are deleted, ``~='' may also match messages whose other copy is
+  ** gone.
+  */
 #if defined(HAVE_GDBM) || defined(HAVE_DB4)
   { "header_cache_pagesize", DT_STR, R_NONE, UL &HeaderCachePageSize, UL "16384" },
   /*
@@ -1310,6 +1325,15 @@ struct option_t MuttVars[] = {
   ** Note that these expandos are supported in
   ** ``$save-hook'', ``$fcc-hook'' and ``$fcc-save-hook'', too.
   */
+  { "intern_strings",	DT_BOOL, R_NONE, OPTINTERNSTRINGS, 1 },
+  /*
+  ** .pp
+  ** When set, mutt keeps a single shared copy of the addresses, real
+  ** names, List-Post and X-Label values of the messages in the mailboxes
+  ** it opens, instead of one copy per message.  Mailing list archives
+  ** repeat these a great deal, so this saves a lot of memory on large
+  ** folders.  It only affects messages read after it is changed.
+  */
   { "ispell",		DT_PATH, R_NONE, UL &Ispell, UL ISPELL },
   /*
   ** .pp
@@ -1628,6 +1652,14 @@ struct option_t MuttVars[] = {
   ** is less than $$pager_index_lines, then the index will only use as
   ** many lines as it needs.
   */
+  { "pager_background_layout", DT_BOOL, R_NONE, OPTPAGERBGLAYOUT, 0 },
+  /*
+  ** .pp
+  ** When \fIset\fP, the internal pager finds the line breaks of the rest
+  ** of the message while it is waiting for a key press, so that jumping to
+  ** the end of a large message or searching it doesn't have to do this
+  ** work first.  The layout stops as soon as input arrives.
+  */
   { "pager_stop",	DT_BOOL, R_NONE, OPTPAGERSTOP, 0 },
   /*
   ** .pp
@@ -2155,6 +2187,16 @@ struct option_t MuttVars[] = {
   ** Those who use the \fCenscript\fP(1) program's mail-printing mode will
   ** most likely want to \fIset\fP this option.
   */
+  { "progressive_open",	DT_BOOL, R_NONE, OPTPROGRESSIVEOPEN, 0 },
+  /*
+  ** .pp
+  ** When \fIset\fP, Mutt shows the index of an mbox or MMDF folder as
+  ** soon as the first messages have been read, and reads the rest of the
+  ** folder while it is waiting for a key press.  The rest is added to the
+  ** index once all of it has been read.  Functions which need all
+  ** messages, like \fC<limit>\fP or \fC<search>\fP, first finish reading
+  ** the folder.  This has no effect on other mailbox types.
+  */
   { "prompt_after",	DT_BOOL, R_NONE, OPTPROMPTAFTER, 1 },
   /*
   ** .pp
@@ -3120,6 +3162,14 @@ struct option_t MuttVars[] = {
   ** raw message received (for example quoted-printable encoded or with encoded
   ** headers) which may lead to incorrect search results.
   */
+  { "thorough_search_memory", DT_NUM, R_NONE, UL &SearchMemory, 1024 },
+  /*
+  ** .pp
+  ** When $$thorough_search is \fIset\fP, messages are decoded in memory
+  ** for searching, up to this many kilobytes of decoded text.  Once a
+  ** message decodes to more, it is moved to a temporary file.  A value
+  ** of 0 always uses temporary files.
+  */
   { "thread_received",	DT_BOOL, R_RESORT|R_RESORT_INIT|R_INDEX, OPTTHREADRECEIVED, 0 },
   /*
   ** .pp
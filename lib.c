@@ -865,13 +865,18 @@ size_t mutt_quote_filename (char *d, size_t l, const char *f)
 
 /* NULL-pointer aware string comparison functions */
 
+/* pooled strings (see $intern_strings) often compare against themselves */
 int mutt_strcmp(const char *a, const char *b)
 {
+  if (a == b)
+    return 0;
   return strcmp(NONULL(a), NONULL(b));
 }
 
 int mutt_strcasecmp(const char *a, const char *b)
 {
+  if (a == b)
+    return 0;
   return strcasecmp(NONULL(a), NONULL(b));
 }
 
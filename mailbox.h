@@ -27,6 +27,7 @@
 #define M_NEWFOLDER	(1<<4) /* create a new folder - same as M_APPEND, but uses
 				* safe_fopen() for mbox-style folders.
 				*/
+#define M_PROGRESSIVE	(1<<5) /* the caller reads the rest with mx_open_more() */
 
 /* mx_open_new_message() */
 #define M_ADD_FROM	1	/* add a From_ line */
@@ -55,6 +56,8 @@ typedef struct
 } MESSAGE;
 
 CONTEXT *mx_open_mailbox (const char *, int, CONTEXT *);
+int mx_open_more (CONTEXT *);
+int mx_open_finish (CONTEXT *);
 
 MESSAGE *mx_open_message (CONTEXT *, int);
 MESSAGE *mx_open_new_message (CONTEXT *, HEADER *, int);
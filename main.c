@@ -1014,7 +1014,7 @@ int main (int argc, char **argv)
 
     mutt_folder_hook (folder);
 
-    if((Context = mx_open_mailbox (folder, ((flags & M_RO) || option (OPTREADONLY)) ? M_READONLY : 0, NULL))
+    if((Context = mx_open_mailbox (folder, (((flags & M_RO) || option (OPTREADONLY)) ? M_READONLY : 0) | M_PROGRESSIVE, NULL))
        || !explicit_folder)
     {
       mutt_index_menu ();
@@ -1027,6 +1027,7 @@ int main (int argc, char **argv)
 #ifdef USE_SASL
     mutt_sasl_done ();
 #endif
+    mutt_iconv_cleanup ();
     mutt_free_opts ();
     mutt_endwin (Errorbuf);
   }
@@ -38,6 +38,9 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+/* messages read per step when a mailbox is opened progressively */
+#define MBOX_OPEN_BATCH 500
+
 /* struct used by mutt_sync_mailbox() to store new offsets */
 struct m_update_t
 {
@@ -126,11 +129,22 @@ int mmdf_parse_mailbox (CONTEXT *ctx)
 
   FOREVER
   {
+    loc = ftello (ctx->fp);
     if (fgets (buf, sizeof (buf) - 1, ctx->fp) == NULL)
+    {
+      ctx->loading = 0;
       break;
+    }
 
     if (mutt_strcmp (buf, MMDF_SEP) == 0)
     {
+      /* leave the rest for mbox_open_more(), starting at this separator */
+      if (ctx->loading && count >= MBOX_OPEN_BATCH)
+      {
+	ctx->loaded = loc;
+	break;
+      }
+
       loc = ftello (ctx->fp);
 
       count++;
@@ -148,6 +162,7 @@ int mmdf_parse_mailbox (CONTEXT *ctx)
       {
 	/* TODO: memory leak??? */
 	dprint (1, (debugfile, "mmdf_parse_mailbox: unexpected EOF\n"));
+	ctx->loading = 0;
 	break;
       }
 
@@ -283,6 +298,10 @@ int mbox_parse_mailbox (CONTEXT *ctx)
   {
     if (is_from (buf, return_path, sizeof (return_path), &t))
     {
+      /* leave the rest for mbox_open_more(), starting at this separator */
+      if (ctx->loading && count >= MBOX_OPEN_BATCH)
+	break;
+
       /* Save the Content-Length of the previous message */
       if (count > 0)
       {
@@ -392,6 +411,14 @@ int mbox_parse_mailbox (CONTEXT *ctx)
     
     loc = ftello (ctx->fp);
   }
+
+  if (ctx->loading)
+  {
+    if (feof (ctx->fp))
+      ctx->loading = 0;
+    else
+      ctx->loaded = loc;
+  }
   
   /*
    * Only set the content-length of the previous message if we have read more
@@ -403,7 +430,7 @@ int mbox_parse_mailbox (CONTEXT *ctx)
   {
     if (PREV->content->length < 0)
     {
-      PREV->content->length = ftello (ctx->fp) - PREV->content->offset - 1;
+      PREV->content->length = loc - PREV->content->offset - 1;
       if (PREV->content->length < 0)
 	PREV->content->length = 0;
     }
@@ -448,6 +475,59 @@ int mbox_open_mailbox (CONTEXT *ctx)
   return (rc);
 }
 
+/* read the next part of a mailbox opened with M_PROGRESSIVE, or with all
+ * set, wait for the lock and read the rest.  If the file changed since the
+ * last part was read, the part read so far may be stale as well, so the
+ * whole mailbox is read again.  Returns 0, M_REOPENED if the mailbox was
+ * read again, -2 if it couldn't be locked, and -1 if it couldn't be read.
+ */
+int mbox_open_more (CONTEXT *ctx, int all)
+{
+  struct stat sb;
+  char buf[LONG_STRING];
+  int rc = -1;
+
+  /* not mbox_lock_mailbox(), which reads on without a lock and makes the
+   * mailbox read-only: a lock held by someone else is only temporary */
+  mutt_block_signals ();
+  if (mx_lock_file (ctx->path, fileno (ctx->fp), 0, 1, all) != 0)
+  {
+    mutt_unblock_signals ();
+    return (-2);
+  }
+  ctx->locked = 1;
+
+  if (stat (ctx->path, &sb) == -1)
+    mutt_perror (ctx->path);
+  else if (sb.st_mtime != ctx->mtime || sb.st_size != ctx->size)
+  {
+    ctx->loading = 0;
+    if (mutt_reopen_mailbox (ctx, NULL) != -1)
+      rc = M_REOPENED;
+  }
+  else if (fseeko (ctx->fp, ctx->loaded, SEEK_SET) == 0 &&
+	   fgets (buf, sizeof (buf), ctx->fp) != NULL &&
+	   ((ctx->magic == M_MBOX && mutt_strncmp ("From ", buf, 5) == 0) ||
+	    (ctx->magic == M_MMDF && mutt_strcmp (MMDF_SEP, buf) == 0)) &&
+	   fseeko (ctx->fp, ctx->loaded, SEEK_SET) == 0)
+  {
+    /* one pass, rather than locking the mailbox again for every part */
+    if (all)
+      ctx->loading = 0;
+
+    if (ctx->magic == M_MBOX)
+      rc = mbox_parse_mailbox (ctx);
+    else
+      rc = mmdf_parse_mailbox (ctx);
+  }
+  else
+    mutt_error _("Mailbox was externally modified.");
+
+  mbox_unlock_mailbox (ctx);
+  mutt_unblock_signals ();
+  return (rc);
+}
+
 /* return 1 if address lists are strictly identical */
 static int strict_addrcmp (const ADDRESS *a, const ADDRESS *b)
 {
@@ -581,6 +661,10 @@ int mbox_check_mailbox (CONTEXT *ctx, int *index_hint)
   int unlock = 0;
   int modified = 0;
 
+  /* the rest of the file isn't new mail */
+  if (ctx->loading)
+    return (0);
+
   if (stat (ctx->path, &st) == 0)
   {
     if (st.st_mtime == ctx->mtime && st.st_size == ctx->size)
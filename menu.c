@@ -34,6 +34,10 @@ extern size_t UngetCount;
 
 char* SearchBuffers[MENU_MAX];
 
+/* bumped whenever the screen is cleared, which invalidates the rows all
+ * menus remember having drawn */
+static unsigned int ScreenGen = 1;
+
 static void print_enriched_string (int attr, unsigned char *s, int do_color)
 {
   wchar_t wc;
@@ -131,7 +135,8 @@ static void print_enriched_string (int attr, unsigned char *s, int do_color)
       }
       if (do_color) attrset(attr);
     }
-    else if ((k = mbrtowc (&wc, (char *)s, n, &mbstate)) > 0)
+    else if ((k = mutt_ascii_run ((char *)s, n)) ||
+	     (k = mbrtowc (&wc, (char *)s, n, &mbstate)) > 0)
     {
       addnstr ((char *)s, k);
       s += k, n-= k;
@@ -163,12 +168,99 @@ static void menu_pad_string (char *s, size_t n)
   FREE (&scratch);
 }
 
+/* to be called when the screen has been cleared */
+void menu_forget_rows (void)
+{
+  ScreenGen++;
+}
+
+static void menu_free_rows (MUTTMENU *menu)
+{
+  int i;
+
+  for (i = 0; i < menu->rowcount; i++)
+    FREE (&menu->rows[i].text);
+  FREE (&menu->rows);
+  menu->rowcount = 0;
+}
+
+/* forget what is shown in the row of entry i */
+static void menu_forget_row (MUTTMENU *menu, int i)
+{
+  i -= menu->top;
+  if (i >= 0 && i < menu->rowcount)
+    FREE (&menu->rows[i].text);
+}
+
+static int menu_same_row (struct menu_row_t *a, struct menu_row_t *b)
+{
+  return a->text && b->text && a->color == b->color &&
+    a->current == b->current && !mutt_strcmp (a->text, b->text);
+}
+
+/*
+ * Rows moved up or down as a block, e.g. when new mail shifted the view,
+ * are scrolled on the screen instead of being drawn again.  Looks for the
+ * shift which keeps the most rows from the first changed one on, scrolls
+ * that part of the screen and moves the remembered rows along.
+ */
+static void menu_scroll_rows (MUTTMENU *menu, struct menu_row_t *rows)
+{
+#ifndef USE_SLANG_CURSES
+  int first, n = menu->rowcount, shift, best = 0, bestcnt = 0, cnt, i;
+
+  for (first = 0; first < n && menu_same_row (&menu->rows[first], &rows[first]); first++)
+    ;
+  if (first == n)
+    return;
+
+  for (shift = first - n + 1; shift < n - first; shift++)
+  {
+    for (i = first, cnt = 0; i < n; i++)
+      if (i - shift >= first && i - shift < n &&
+	  menu_same_row (&menu->rows[i - shift], &rows[i]))
+	cnt++;
+    if (cnt > bestcnt || (cnt == bestcnt && shift == 0))
+    {
+      best = shift;
+      bestcnt = cnt;
+    }
+  }
+  if (best == 0 || bestcnt < 2)
+    return;
+
+  scrollok (stdscr, TRUE);
+  setscrreg (menu->offset + first, menu->offset + n - 1);
+  scrl (-best);
+  setscrreg (0, LINES - 1);
+  scrollok (stdscr, FALSE);
+
+  if (best > 0)
+  {
+    for (i = n - best; i < n; i++)
+      FREE (&menu->rows[i].text);
+    memmove (&menu->rows[first + best], &menu->rows[first],
+	     (n - first - best) * sizeof (struct menu_row_t));
+    memset (&menu->rows[first], 0, best * sizeof (struct menu_row_t));
+  }
+  else
+  {
+    for (i = first; i < first - best; i++)
+      FREE (&menu->rows[i].text);
+    memmove (&menu->rows[first], &menu->rows[first - best],
+	     (n - first + best) * sizeof (struct menu_row_t));
+    memset (&menu->rows[n + best], 0, -best * sizeof (struct menu_row_t));
+  }
+#endif
+}
+
 void menu_redraw_full (MUTTMENU *menu)
 {
   SETCOLOR (MT_COLOR_NORMAL);
   /* clear() doesn't optimize screen redraws */
   move (0, 0);
   clrtobot ();
+  menu_forget_rows ();
 
   if (option (OPTHELP))
   {
@@ -205,15 +297,49 @@ void menu_redraw_status (MUTTMENU *menu)
 void menu_redraw_index (MUTTMENU *menu)
 {
   char buf[LONG_STRING];
-  int i;
+  struct menu_row_t *rows;
+  int i, r;
 
-  for (i = menu->top; i < menu->top + menu->pagelen; i++)
+  if (menu->rowgen != ScreenGen || menu->rowcount != menu->pagelen ||
+      menu->rowoffset != menu->offset)
+  {
+    menu_free_rows (menu);
+    menu->rows = safe_calloc (menu->pagelen, sizeof (struct menu_row_t));
+    menu->rowcount = menu->pagelen;
+    menu->rowoffset = menu->offset;
+    menu->rowgen = ScreenGen;
+  }
+
+  rows = safe_calloc (menu->pagelen, sizeof (struct menu_row_t));
+  for (i = menu->top, r = 0; r < menu->pagelen; i++, r++)
   {
     if (i < menu->max)
     {
       menu_make_entry (buf, sizeof (buf), menu, i);
       menu_pad_string (buf, sizeof (buf));
+      rows[r].text = mutt_substrdup (buf, NULL);
+      rows[r].color = menu->color (i);
+      rows[r].current = (i == menu->current);
+    }
+    else
+      rows[r].text = mutt_substrdup ("", NULL);
+  }
+
+  menu_scroll_rows (menu, rows);
+
+  for (i = menu->top, r = 0; r < menu->pagelen; i++, r++)
+  {
+    if (menu_same_row (&menu->rows[r], &rows[r]))
+    {
+      FREE (&rows[r].text);
+      continue;
+    }
+    FREE (&menu->rows[r].text);
+    menu->rows[r] = rows[r];
+    strfcpy (buf, rows[r].text, sizeof (buf));
 
+    if (i < menu->max)
+    {
       if (option (OPTARROWCURSOR))
       {
         attrset (menu->color (i));
@@ -253,8 +379,12 @@ void menu_redraw_index (MUTTMENU *menu)
       }
     }
     else
+    {
+      SETCOLOR (MT_COLOR_NORMAL);
       CLEARLINE (i - menu->top + menu->offset);
+    }
   }
+  FREE (&rows);
   menu->redraw = 0;
 }
 
@@ -267,6 +397,9 @@ void menu_redraw_motion (MUTTMENU *menu)
     menu->redraw &= ~REDRAW_MOTION;
     return;
   }
+
+  menu_forget_row (menu, menu->oldcurrent);
+  menu_forget_row (menu, menu->current);
   
   move (menu->oldcurrent + menu->offset - menu->top, 0);
   SETCOLOR (MT_COLOR_NORMAL);
@@ -321,6 +454,8 @@ void menu_redraw_motion (MUTTMENU *menu)
 void menu_redraw_current (MUTTMENU *menu)
 {
   char buf[LONG_STRING];
+
+  menu_forget_row (menu, menu->current);
   
   move (menu->current + menu->offset - menu->top, 0);
   menu_make_entry (buf, sizeof (buf), menu, menu->current);
@@ -672,7 +807,7 @@ static int menu_search_generic (MUTTMENU *m, regex_t *re, int n)
   char buf[LONG_STRING];
 
   menu_make_entry (buf, sizeof (buf), m, n);
-  return (regexec (re, buf, 0, NULL, 0));
+  return (mutt_prefilter_regexec (re, m->prefilter, buf, 0, NULL, 0));
 }
 
 void mutt_menu_init (void)
@@ -710,6 +845,7 @@ void mutt_menuDestroy (MUTTMENU **p)
     FREE (& (*p)->dialog);
   }
 
+  menu_free_rows (*p);
   FREE (p);		/* __FREE_CHECKED__ */
 }
 
@@ -753,6 +889,7 @@ static int menu_search (MUTTMENU *menu, int op)
     mutt_error ("%s", buf);
     return (-1);
   }
+  menu->prefilter = mutt_prefilter_new (searchBuf, mutt_which_case (searchBuf));
 
   r = menu->current + searchDir;
 search_next:
@@ -763,6 +900,7 @@ search_next:
     if (menu->search (menu, &re, r) == 0)
     {
       regfree (&re);
+      mutt_prefilter_free (&menu->prefilter);
       return r;
     }
 
@@ -775,6 +913,7 @@ search_next:
     goto search_next;
   }
   regfree (&re);
+  mutt_prefilter_free (&menu->prefilter);
   mutt_error _("Not found.");
   return (-1);
 }
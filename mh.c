@@ -1101,8 +1101,43 @@ static void maildir_delayed_parsing (CONTEXT * ctx, struct maildir **md,
   mh_sort_natural (ctx, md);
 }
 
+#if USE_HCACHE
+/* store the MIME summaries worked out during this session, so that
+ * attachment counts don't need the messages read next time */
+static void mh_store_summaries (CONTEXT *ctx)
+{
+  header_cache_t *hc = NULL;
+  HEADER *h;
+  int i;
+
+  for (i = 0; i < ctx->msgcount; i++)
+  {
+    h = ctx->hdrs[i];
+    /* the sync may just have removed deleted ones from the cache */
+    if (!h || !h->summary_changed || !h->path || h->deleted)
+      continue;
+
+    if (!hc && !(hc = mutt_hcache_open (HeaderCache, ctx->path, NULL)))
+      return;
+
+    if (ctx->magic == M_MAILDIR)
+      mutt_hcache_store (hc, h->path + 3, h, 0, &maildir_hcache_keylen);
+    else
+      mutt_hcache_store (hc, h->path, h, 0, strlen);
+    h->summary_changed = 0;
+  }
+
+  if (hc)
+    mutt_hcache_close (hc);
+}
+#endif
+
 static int mh_close_mailbox (CONTEXT *ctx)
 {
+#if USE_HCACHE
+  mh_store_summaries (ctx);
+#endif
+
   FREE (&ctx->data);
 
   return 0;
@@ -1932,8 +1967,12 @@ int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
       if (!ctx->hdrs[i]->changed)
 	maildir_update_flags (ctx, ctx->hdrs[i], p->h);
 
-      if (ctx->hdrs[i]->deleted == ctx->hdrs[i]->trash)
+      if (ctx->hdrs[i]->deleted == ctx->hdrs[i]->trash &&
+	  ctx->hdrs[i]->deleted != p->h->deleted)
+      {
 	ctx->hdrs[i]->deleted = p->h->deleted;
+	mutt_header_changed (ctx->hdrs[i]);
+      }
       ctx->hdrs[i]->trash = p->h->trash;
 
       /* this is a duplicate of an existing header, so remove it */
@@ -344,6 +344,7 @@ enum
   OPTFORWDECODE,
   OPTFORWQUOTE,
 #ifdef USE_HCACHE
+  OPTHCACHEMSGID,
   OPTHCACHEVERIFY,
 #if defined(HAVE_QDBM) || defined(HAVE_TC)
   OPTHCACHECOMPRESS,
@@ -382,6 +383,7 @@ enum
 #endif /* defined(USE_SSL) */
   OPTIMPLICITAUTOVIEW,
   OPTINCLUDEONLYFIRST,
+  OPTINTERNSTRINGS,
   OPTKEEPFLAGGED,
   OPTMAILCAPSANITIZE,
   OPTMAILDIRTRASH,
@@ -397,6 +399,7 @@ enum
   OPTMHPURGE,
   OPTMIMEFORWDECODE,
   OPTNARROWTREE,
+  OPTPAGERBGLAYOUT,
   OPTPAGERSTOP,
   OPTPIPEDECODE,
   OPTPIPESPLIT,
@@ -406,6 +409,7 @@ enum
 #endif
   OPTPRINTDECODE,
   OPTPRINTSPLIT,
+  OPTPROGRESSIVEOPEN,
   OPTPROMPTAFTER,
   OPTREADONLY,
   OPTREPLYSELF,
@@ -734,34 +738,55 @@ typedef struct header
 
   /* tells whether the attachment count is valid */
   unsigned int attach_valid : 1;
+  unsigned int summary_changed : 1;	/* mime_summary is not in the header cache yet */
+
+  /* the score was decided by an exact score rule */
+  unsigned int score_exact : 1;
+  unsigned int score_stale : 1;	/* flags or headers changed since scored */
 
   /* the following are used to support collapsing threads  */
   unsigned int collapsed : 1; 	/* is this message part of a collapsed thread? */
   unsigned int limited : 1;   	/* is this message in a limited view?  */
-  size_t num_hidden;          	/* number of hidden messages in this view */
-
-  short recipient;		/* user_is_recipient()'s return value, cached */
-  
-  int pair; 			/* color-pair to use when displaying in the index */
 
+  /* The members up to and including `thread' are the ones read by loops
+   * over the whole mailbox (limiting, tagging, sorting, flag counts in
+   * mx_update_context()).  Keep them together at the front, they fit in
+   * a single 64 byte cache line on LP64, and add anything only used for
+   * the message being displayed, synced or threaded below them.
+   */
   time_t date_sent;     	/* time when the message was sent (UTC) */
   time_t received;      	/* time when the message was placed in the mailbox */
-  LOFF_T offset;          	/* where in the stream does this message begin? */
-  int lines;			/* how many lines in the body of this message? */
   int index;			/* the absolute (unsorted) message number */
   int msgno;			/* number displayed to the user */
   int virtual;			/* virtual message number */
   int score;
   ENVELOPE *env;		/* envelope information */
   BODY *content;		/* list of MIME parts */
-  char *path;
-  
-  char *tree;           	/* character string to print thread tree */
   THREAD *thread;
 
+  int lines;			/* how many lines in the body of this message? */
+  short recipient;		/* user_is_recipient()'s return value, cached */
+
   /* Number of qualifying attachments in message, if attach_valid */
   short attach_total;
 
+  int score_raw;		/* score before clamping, see score.c */
+  unsigned int score_gen;	/* generation of the rules score was computed with */
+
+  int pair; 			/* color-pair to use when displaying in the index */
+  unsigned int color_gen;	/* ColorIndexGen pair was computed for, 0 if none */
+
+  LOFF_T offset;          	/* where in the stream does this message begin? */
+  size_t num_hidden;          	/* number of hidden messages in this view */
+
+  char *index_line;		/* formatted index entry, see index_make_entry() */
+  unsigned int line_gen;	/* generation of index_line, 0 if none */
+  int line_flag;		/* format flags index_line was made with */
+
+  char *path;
+  char *tree;           	/* character string to print thread tree */
+  char *mime_summary;		/* shape of the MIME part tree, see parse.c */
+
 #ifdef MIXMASTER
   LIST *chain;
 #endif
@@ -793,6 +818,13 @@ struct mutt_thread
   THREAD *prev;
   HEADER *message;
   HEADER *sort_key;
+
+  /* aggregates for the whole thread, only kept on top level nodes and
+   * valid as long as count_gen matches the context's thread_gen */
+  unsigned int count_gen;
+  int unread_new;		/* unread new messages within the limit */
+  int unread_old;		/* unread old messages within the limit */
+  int hidden;			/* hidden messages within the limit */
 };
 
 
@@ -834,6 +866,7 @@ typedef struct pattern_t
     group_t *g;
     char *str;
   } p;
+  PREFILTER *prefilter;			/* required literal of p.rx */
 } pattern_t;
 
 /* ACL Rights */
@@ -861,6 +894,7 @@ typedef struct _context
   time_t mtime;
   off_t size;
   off_t vsize;
+  off_t loaded;			/* how much of it has been read, while loading */
   char *pattern;                /* limit pattern string */
   pattern_t *limit_pattern;     /* compiled limit pattern */
   HEADER **hdrs;
@@ -878,7 +912,9 @@ typedef struct _context
   int unread;			/* how many unread messages? */
   int deleted;			/* how many deleted messages */
   int flagged;			/* how many flagged messages */
+  int hidden;			/* read while loading, not in the index yet */
   int msgnotreadyet;		/* which msg "new" in pager, -1 if none */
+  unsigned int thread_gen;	/* invalidates the thread aggregates */
 
   short magic;			/* mailbox type */
 
@@ -892,6 +928,7 @@ typedef struct _context
   unsigned int quiet : 1;	/* inhibit status messages? */
   unsigned int collapsed : 1;   /* are all threads collapsed? */
   unsigned int closing : 1;	/* mailbox is being closed */
+  unsigned int loading : 1;	/* only part of the mailbox has been read */
 
   /* driver hooks */
   void *data;			/* driver specific data */
@@ -940,6 +977,23 @@ int  state_printf(STATE *, const char *, ...);
 int state_putwc (wchar_t, STATE *);
 int state_putws (const wchar_t *, STATE *);
 
+/* a STATE output which is read back once it has been written, kept in
+ * memory until it grows too large */
+typedef struct
+{
+  FILE *fp;
+  char *buf;			/* contents, while kept in memory */
+  size_t len;			/* bytes written */
+  size_t size;			/* allocated size of buf */
+  size_t limit;			/* largest len kept in memory */
+  FILE *spill;			/* the temporary file, once it has one */
+  char *tempfile;
+} STATE_SINK;
+
+int state_sink_open (STATE_SINK *, LOFF_T);
+LOFF_T state_sink_rewind (STATE_SINK *);
+void state_sink_close (STATE_SINK *);
+
 /* for attachment counter */
 typedef struct
 {
@@ -97,6 +97,8 @@ event_t mutt_getch (void);
 
 void mutt_endwin (const char *);
 void mutt_flushinp (void);
+int mutt_input_pending (void);
+int mutt_input_wait (int);
 void mutt_refresh (void);
 void mutt_resize_screen (void);
 void mutt_ungetch (int, int);
@@ -179,6 +181,7 @@ extern int ColorDefs[];
 extern COLOR_LINE *ColorHdrList;
 extern COLOR_LINE *ColorBodyList;
 extern COLOR_LINE *ColorIndexList;
+extern unsigned int ColorIndexGen;
 
 void ci_init_color (void);
 void ci_start_color (void);
@@ -155,7 +155,7 @@ static int mbox_to_udomain (const char *mbx, char **user, char **domain)
 int mutt_addrlist_to_idna (ADDRESS *a, char **err)
 {
   char *user = NULL, *domain = NULL;
-  char *tmp = NULL;
+  char *tmp = NULL, *p;
   int e = 0;
   
   if (err)
@@ -176,8 +176,11 @@ int mutt_addrlist_to_idna (ADDRESS *a, char **err)
     }
     else
     {
-      safe_realloc (&a->mailbox, mutt_strlen (user) + mutt_strlen (tmp) + 2);
-      sprintf (a->mailbox, "%s@%s", NONULL(user), NONULL(tmp)); /* __SPRINTF_CHECKED__ */
+      /* don't realloc: the old mailbox may be shared, see $intern_strings */
+      p = safe_malloc (mutt_strlen (user) + mutt_strlen (tmp) + 2);
+      sprintf (p, "%s@%s", NONULL(user), NONULL(tmp)); /* __SPRINTF_CHECKED__ */
+      mutt_str_unintern (&a->mailbox);
+      a->mailbox = p;
       a->idn_checked = 0;
     }
     
@@ -193,7 +196,7 @@ int mutt_addrlist_to_idna (ADDRESS *a, char **err)
 int mutt_addrlist_to_local (ADDRESS *a)
 {
   char *user, *domain;
-  char *tmp = NULL;
+  char *tmp = NULL, *p;
   
   for (; a; a = a->next)
   {
@@ -205,8 +208,10 @@ int mutt_addrlist_to_local (ADDRESS *a)
       continue;
     if (mutt_idna_to_local (domain, &tmp, 0) == 0)
     {
-      safe_realloc (&a->mailbox, mutt_strlen (user) + mutt_strlen (tmp) + 2);
-      sprintf (a->mailbox, "%s@%s", NONULL (user), NONULL (tmp)); /* __SPRINTF_CHECKED__ */
+      p = safe_malloc (mutt_strlen (user) + mutt_strlen (tmp) + 2);
+      sprintf (p, "%s@%s", NONULL (user), NONULL (tmp)); /* __SPRINTF_CHECKED__ */
+      mutt_str_unintern (&a->mailbox);
+      a->mailbox = p;
       a->idn_checked = 0;
     }
     
@@ -37,6 +37,14 @@
 
 #define M_MODEFMT "-- Mutt: %s"
 
+/* what a row of the menu shows on the screen */
+struct menu_row_t
+{
+  char *text;		/* NULL if not known */
+  int color;
+  int current;
+};
+
 typedef struct menu_t
 {
   char *title;   /* the title of this menu */
@@ -76,7 +84,14 @@ typedef struct menu_t
   int top;		/* entry that is the top of the current page */
   int oldcurrent;	/* for driver use only. */
   int searchDir;	/* direction of search */
+  PREFILTER *prefilter;	/* required literal of the current search */
   int tagged;		/* number of tagged entries */
+
+  /* the rows drawn by menu_redraw_index(), so unchanged ones are skipped */
+  struct menu_row_t *rows;
+  int rowcount;
+  int rowoffset;	/* screen row they were drawn at */
+  unsigned int rowgen;	/* screen generation they belong to */
 } MUTTMENU;
 
 void mutt_menu_init (void);
@@ -86,6 +101,7 @@ void menu_redraw_index (MUTTMENU *);
 void menu_redraw_status (MUTTMENU *);
 void menu_redraw_motion (MUTTMENU *);
 void menu_redraw_current (MUTTMENU *);
+void menu_forget_rows (void);
 int  menu_redraw (MUTTMENU *);
 void menu_first_entry (MUTTMENU *);
 void menu_last_entry (MUTTMENU *);
@@ -46,6 +46,23 @@ typedef struct
   int not;		/* do not match */
 } REGEXP;
 
+/* required literal of a regular expression, see prefilter.c */
+typedef struct prefilter
+{
+  unsigned char *lit;		/* the literal, folded to lower case if icase */
+  size_t len;
+  int icase;
+  unsigned char fold[256];	/* case folding map for the haystack */
+  size_t shift[256];		/* Horspool bad character shifts */
+} PREFILTER;
+
+PREFILTER *mutt_prefilter_new (const char *, int);
+void mutt_prefilter_free (PREFILTER **);
+const char *mutt_prefilter_find (const PREFILTER *, const char *, size_t);
+int mutt_prefilter_match (const PREFILTER *, const char *, size_t);
+int mutt_prefilter_regexec (const regex_t *, const PREFILTER *, const char *,
+			    size_t, regmatch_t [], int);
+
 WHERE REGEXP Mask;
 WHERE REGEXP QuoteRegexp;
 WHERE REGEXP ReplyRegexp;
@@ -332,8 +332,10 @@ void mutt_free_header (HEADER **h)
   mutt_free_envelope (&(*h)->env);
   mutt_free_body (&(*h)->content);
   FREE (&(*h)->maildir_flags);
+  FREE (&(*h)->mime_summary);
   FREE (&(*h)->tree);
   FREE (&(*h)->path);
+  FREE (&(*h)->index_line);
 #ifdef MIXMASTER
   mutt_free_list (&(*h)->chain);
 #endif
@@ -715,13 +717,13 @@ void mutt_free_envelope (ENVELOPE **p)
   rfc822_free_address (&(*p)->reply_to);
   rfc822_free_address (&(*p)->mail_followup_to);
 
-  FREE (&(*p)->list_post);
+  mutt_str_unintern (&(*p)->list_post);
   FREE (&(*p)->subject);
   /* real_subj is just an offset to subject and shouldn't be freed */
   FREE (&(*p)->message_id);
   FREE (&(*p)->supersedes);
   FREE (&(*p)->date);
-  FREE (&(*p)->x_label);
+  mutt_str_unintern (&(*p)->x_label);
 
   mutt_buffer_free (&(*p)->spam);
 
@@ -731,6 +733,136 @@ void mutt_free_envelope (ENVELOPE **p)
   FREE (p);		/* __FREE_CHECKED__ */
 }
 
+/* Strings shared between messages, see $intern_strings.  The pool maps
+ * each string to its reference count; the string itself is the key.
+ * Only fields that are released with mutt_str_unintern() may hold a
+ * pooled string.
+ *
+ * The pool is global, since addresses are freed in many places that don't
+ * know which mailbox they came from.  So that a small mailbox doesn't pay
+ * for a table sized for the largest one, the pool starts small and grows
+ * with the number of strings in it, at the cost of rehashing them all
+ * every time it grows.  Once the last string is gone, usually because the
+ * mailbox was closed, the table itself is freed as well. */
+#define INTERN_HASH_SIZE 1021
+
+static HASH *InternPool = NULL;
+static int InternCount = 0;	/* distinct strings in the pool */
+
+/* spread the pooled strings over a table four times as large */
+static void intern_grow (void)
+{
+  struct hash_elem **table, *e, *next;
+  unsigned int h;
+  int nelem, i;
+
+  nelem = InternPool->nelem * 4 + 1;
+  table = safe_calloc (nelem, sizeof (struct hash_elem *));
+  for (i = 0; i < InternPool->nelem; i++)
+  {
+    for (e = InternPool->table[i]; e; e = next)
+    {
+      next = e->next;
+      h = InternPool->hash_string ((unsigned char *) e->key, nelem);
+      e->next = table[h];
+      table[h] = e;
+    }
+  }
+  FREE (&InternPool->table);
+  InternPool->table = table;
+  InternPool->nelem = nelem;
+}
+
+/* replace the malloc()ed string *p with the pooled copy of it, adding
+ * *p to the pool if it isn't there yet */
+void mutt_str_intern (char **p)
+{
+  struct hash_elem *e;
+  unsigned int h;
+
+  if (!*p)
+    return;
+
+  if (!InternPool)
+    InternPool = hash_create (INTERN_HASH_SIZE, 0);
+
+  h = InternPool->hash_string ((unsigned char *) *p, InternPool->nelem);
+  for (e = InternPool->table[h]; e; e = e->next)
+  {
+    if (e->key == *p)
+      return;			/* already pooled */
+    if (!strcmp (e->key, *p))
+    {
+      e->data = (void *) ((long) e->data + 1);
+      FREE (p);
+      *p = (char *) e->key;
+      return;
+    }
+  }
+
+  hash_insert (InternPool, *p, (void *) 1L, 1);
+  if (++InternCount > 2 * InternPool->nelem)
+    intern_grow ();
+}
+
+/* drop a reference to a pooled string, or free *p if it isn't pooled */
+void mutt_str_unintern (char **p)
+{
+  struct hash_elem *e, **last;
+  unsigned int h;
+
+  if (!*p)
+    return;
+
+  if (InternPool)
+  {
+    h = InternPool->hash_string ((unsigned char *) *p, InternPool->nelem);
+    for (last = &InternPool->table[h]; (e = *last) != NULL; last = &e->next)
+    {
+      if (e->key != *p)
+	continue;
+
+      if ((long) e->data > 1)
+      {
+	e->data = (void *) ((long) e->data - 1);
+	*p = NULL;
+	return;
+      }
+
+      *last = e->next;
+      FREE (&e);
+      if (--InternCount == 0)
+	hash_destroy (&InternPool, NULL);
+      break;
+    }
+  }
+
+  FREE (p);		/* __FREE_CHECKED__ */
+}
+
+static void intern_adrlist (ADDRESS *a)
+{
+  for (; a; a = a->next)
+  {
+    mutt_str_intern (&a->personal);
+    mutt_str_intern (&a->mailbox);
+  }
+}
+
+void mutt_intern_envelope (ENVELOPE *e)
+{
+  intern_adrlist (e->return_path);
+  intern_adrlist (e->from);
+  intern_adrlist (e->to);
+  intern_adrlist (e->cc);
+  intern_adrlist (e->bcc);
+  intern_adrlist (e->sender);
+  intern_adrlist (e->reply_to);
+  intern_adrlist (e->mail_followup_to);
+  mutt_str_intern (&e->list_post);
+  mutt_str_intern (&e->x_label);
+}
+
 /* move all the headers from extra not present in base into base */
 void mutt_merge_envelopes(ENVELOPE* base, ENVELOPE** extra)
 {
@@ -1049,6 +1181,538 @@ void mutt_safe_path (char *s, size_t l, ADDRESS *a)
 }
 
 
+/*
+ * Format strings are compiled into a list of operations the first time
+ * they are used, so that the hot paths (index, status line, menus) don't
+ * parse conditionals, padding and filters over and over again.  Compiled
+ * formats are kept in a small cache keyed by the address of the template
+ * and checked against its contents, so a format is only compiled again
+ * after it has changed.
+ */
+
+enum
+{
+  FMT_LITERAL,		/* copy text */
+  FMT_CHAR,		/* a single character from %% or a \ escape */
+  FMT_EXPANDO,		/* an expando handled by the callback */
+  FMT_PAD,		/* %>X and %*X */
+  FMT_FILL		/* %|X */
+};
+
+typedef struct format_op
+{
+  short type;
+  short optional;	/* %?x?...? */
+  short tolower;	/* %_x */
+  short nodots;		/* %:x */
+  char ch;
+  short ascii;		/* FMT_LITERAL is printable ASCII only */
+  size_t start;		/* offset of the op in the template */
+  size_t off;		/* offset of the literal text, of the callback's
+			 * argument, or of the padding character */
+  size_t len;		/* length of the literal text */
+  char *prefix;
+  char *ifstring;
+  char *elsestring;
+  /* the callback may consume more of the template than the op itself,
+   * in which case the rest of the template is compiled separately */
+  struct format_prog *tail;
+  format_t *tail_callback;
+  size_t tail_off;
+} FORMAT_OP;
+
+typedef struct format_prog
+{
+  char *src;		/* private copy of the template */
+  int filter;		/* template ends with an unescaped | */
+  int busy;		/* number of frames running this program */
+  FORMAT_OP *ops;
+  int nops;
+} FORMAT_PROG;
+
+typedef struct format_state
+{
+  char *dest;
+  char *wptr;
+  size_t destlen;
+  size_t wlen;
+  size_t col;
+  format_t *callback;
+  unsigned long data;
+  format_flag flags;
+} FORMAT_STATE;
+
+#define FORMAT_CACHE_SIZE 64
+
+static FORMAT_PROG *FormatCache[FORMAT_CACHE_SIZE];
+
+static FORMAT_OP *format_new_op (FORMAT_PROG *prog, short type, size_t start)
+{
+  FORMAT_OP *op;
+
+  safe_realloc (&prog->ops, (prog->nops + 1) * sizeof (FORMAT_OP));
+  op = &prog->ops[prog->nops++];
+  memset (op, 0, sizeof (FORMAT_OP));
+  op->type = type;
+  op->start = start;
+  return op;
+}
+
+static void format_free (FORMAT_PROG **prog)
+{
+  int i;
+
+  if (!prog || !*prog)
+    return;
+
+  for (i = 0; i < (*prog)->nops; i++)
+  {
+    FREE (&(*prog)->ops[i].prefix);
+    FREE (&(*prog)->ops[i].ifstring);
+    FREE (&(*prog)->ops[i].elsestring);
+    format_free (&(*prog)->ops[i].tail);
+  }
+  FREE (&(*prog)->ops);
+  FREE (&(*prog)->src);
+  FREE (prog);		/* __FREE_CHECKED__ */
+}
+
+/* eat the `if' or `else' part of a conditional */
+static char *format_eat_branch (const char **src, const char *stop)
+{
+  const char *p = *src;
+
+  while (*src - p < SHORT_STRING - 1 && **src && !strchr (stop, **src))
+    (*src)++;
+  return mutt_substrdup (p, *src);
+}
+
+/* Compile template.  Only top level templates may be filters. */
+static FORMAT_PROG *format_compile (const char *template, int filter)
+{
+  FORMAT_PROG *prog;
+  FORMAT_OP *op;
+  const char *src, *p, *prefix = NULL;
+  int n, off, tmp;
+
+  prog = safe_calloc (1, sizeof (FORMAT_PROG));
+  /* safe_strdup() would turn "" into NULL */
+  template = NONULL (template);
+  prog->src = mutt_substrdup (template, template + mutt_strlen (template));
+  src = prog->src;
+
+  /* Do not consider filters if no pipe at end */
+  n = mutt_strlen (src);
+  if (filter && n > 1 && src[n-1] == '|')
+  {
+    /* Scan backwards for backslashes */
+    off = n;
+    while (off > 0 && src[off-2] == '\\')
+      off--;
+
+    /* If number of backslashes is even, the pipe is real. */
+    /* n-off is the number of backslashes. */
+    prog->filter = off > 0 && ((n-off) % 2) == 0;
+  }
+
+  while (*src)
+  {
+    if (*src == '%')
+    {
+      p = src++;
+      if (*src == '%')
+      {
+	op = format_new_op (prog, FMT_CHAR, p - prog->src);
+	op->ch = '%';
+	src++;
+	continue;
+      }
+
+      op = format_new_op (prog, FMT_EXPANDO, p - prog->src);
+      if (*src == '?')
+      {
+	/* conditionals get the prefix of the last expando */
+	op->optional = 1;
+	op->prefix = safe_strdup (prefix);
+	src++;
+      }
+      else
+      {
+	/* eat the format string */
+	p = src;
+	while (src - p < SHORT_STRING - 1 &&
+	       (isdigit ((unsigned char) *src) || *src == '.' || *src == '-' || *src == '='))
+	  src++;
+	op->prefix = mutt_substrdup (p, src);
+	prefix = op->prefix;
+      }
+
+      if (!*src)
+      {
+	FREE (&op->prefix);
+	prog->nops--;
+	break; /* bad format */
+      }
+
+      op->ch = *src++; /* save the character to switch on */
+
+      if (op->optional)
+      {
+	if (*src != '?')
+	{
+	  FREE (&op->prefix);
+	  prog->nops--;
+	  break; /* bad format */
+	}
+	src++;
+
+	op->ifstring = format_eat_branch (&src, "?&");
+	if (*src == '&')
+	  src++; /* skip the & */
+	op->elsestring = format_eat_branch (&src, "?");
+
+	if (!*src)
+	{
+	  FREE (&op->prefix);
+	  FREE (&op->ifstring);
+	  FREE (&op->elsestring);
+	  prog->nops--;
+	  break; /* bad format */
+	}
+
+	src++; /* move past the trailing `?' */
+      }
+
+      if (op->ch == '>' || op->ch == '*' || op->ch == '|')
+      {
+	if (!*src)
+	{
+	  FREE (&op->prefix);
+	  FREE (&op->ifstring);
+	  FREE (&op->elsestring);
+	  prog->nops--;
+	  break; /* no padding character */
+	}
+	op->type = op->ch == '|' ? FMT_FILL : FMT_PAD;
+	op->off = src - prog->src;
+	break; /* skip rest of input */
+      }
+
+      while (op->ch == '_' || op->ch == ':')
+      {
+	if (op->ch == '_')
+	  op->tolower = 1;
+	else
+	  op->nodots = 1;
+
+	op->ch = *src++;
+      }
+      if (!op->ch)
+      {
+	FREE (&op->prefix);
+	FREE (&op->ifstring);
+	FREE (&op->elsestring);
+	prog->nops--;
+	break; /* bad format */
+      }
+      op->off = src - prog->src;
+    }
+    else if (*src == '\\')
+    {
+      if (!*++src)
+	break;
+      op = format_new_op (prog, FMT_CHAR, src - 1 - prog->src);
+      switch (*src)
+      {
+	case 'n':
+	  op->ch = '\n';
+	  break;
+	case 't':
+	  op->ch = '\t';
+	  break;
+	case 'r':
+	  op->ch = '\r';
+	  break;
+	case 'f':
+	  op->ch = '\f';
+	  break;
+	case 'v':
+	  op->ch = '\v';
+	  break;
+	default:
+	  op->ch = *src;
+	  break;
+      }
+      src++;
+    }
+    else
+    {
+      op = format_new_op (prog, FMT_LITERAL, src - prog->src);
+      op->off = op->start;
+      op->ascii = 1;
+      while (*src && *src != '%' && *src != '\\')
+      {
+	if ((unsigned char) *src < 0x20 || (unsigned char) *src > 0x7e)
+	  op->ascii = 0;
+	/* never split a multibyte character */
+	if ((tmp = mutt_charlen (src, NULL)) <= 0)
+	  tmp = 1;
+	src += tmp;
+      }
+      op->len = src - prog->src - op->off;
+    }
+  }
+
+  return prog;
+}
+
+/* Find the compiled program for template, compiling it if necessary.
+ * Programs which aren't in the cache are marked as temporary and must be
+ * freed by the caller. */
+static FORMAT_PROG *format_lookup (const char *template, int *temporary)
+{
+  FORMAT_PROG **slot;
+  unsigned long k = (unsigned long) template;
+
+  slot = &FormatCache[(k ^ (k >> 7)) % FORMAT_CACHE_SIZE];
+  *temporary = 0;
+
+  if (*slot && !strcmp ((*slot)->src, template))
+    return *slot;
+
+  /* don't pull a program out from under a frame still running it */
+  if (*slot && (*slot)->busy)
+  {
+    *temporary = 1;
+    return format_compile (template, 1);
+  }
+
+  format_free (slot);
+  *slot = format_compile (template, 1);
+  return *slot;
+}
+
+static void format_run (FORMAT_PROG *prog, FORMAT_STATE *st)
+{
+  char buf[LONG_STRING];
+  FORMAT_OP *op;
+  FORMAT_PROG *tail;
+  const char *src, *next;
+  size_t len, wid, j, off;
+  int i, k;
+
+  prog->busy++;
+
+  for (i = 0; i < prog->nops && st->wlen < st->destlen; i++)
+  {
+    op = &prog->ops[i];
+    src = prog->src + op->off;
+
+    switch (op->type)
+    {
+      case FMT_CHAR:
+	*st->wptr++ = op->ch;
+	st->wlen++;
+	st->col++;
+	break;
+
+      case FMT_LITERAL:
+	if (op->ascii && st->wlen + op->len < st->destlen)
+	{
+	  memcpy (st->wptr, src, op->len);
+	  st->wptr += op->len;
+	  st->wlen += op->len;
+	  st->col += op->len;
+	  break;
+	}
+
+	for (j = 0; j < op->len; )
+	{
+	  int tmp, w;
+	  /* in case of error, simply copy byte */
+	  if ((tmp = mutt_charlen (src + j, &w)) < 0)
+	    tmp = w = 1;
+	  if (tmp > 0 && st->wlen + tmp < st->destlen)
+	  {
+	    memcpy (st->wptr, src + j, tmp);
+	    st->wptr += tmp;
+	    j += tmp;
+	    st->wlen += tmp;
+	    st->col += w;
+	  }
+	  else
+	  {
+	    st->wlen = st->destlen;
+	    break;
+	  }
+	}
+	break;
+
+      case FMT_PAD:
+      {
+	/* %>X: right justify to EOL, left takes precedence
+	 * %*X: right justify to EOL, right takes precedence */
+	int soft = op->ch == '*';
+	int pl, pw;
+
+	if (op->optional)
+	  st->flags |= M_FORMAT_OPTIONAL;
+	else
+	  st->flags &= ~M_FORMAT_OPTIONAL;
+
+	if ((pl = mutt_charlen (src, &pw)) <= 0)
+	  pl = pw = 1;
+
+	/* see if there's room to add content, else ignore */
+	if ((st->col < COLS && st->wlen < st->destlen) || soft)
+	{
+	  int pad;
+
+	  /* get contents after padding */
+	  mutt_FormatString (buf, sizeof (buf), 0, src + pl, st->callback,
+			     st->data, st->flags);
+	  len = mutt_strlen (buf);
+	  wid = mutt_strwidth (buf);
+
+	  /* try to consume as many columns as we can, if we don't have
+	   * memory for that, use as much memory as possible */
+	  pad = (COLS - st->col - wid) / pw;
+	  if (pad > 0 && st->wlen + (pad * pl) + len > st->destlen)
+	    pad = ((signed)(st->destlen - st->wlen - len)) / pl;
+	  if (pad > 0)
+	  {
+	    while (pad--)
+	    {
+	      memcpy (st->wptr, src, pl);
+	      st->wptr += pl;
+	      st->wlen += pl;
+	      st->col += pw;
+	    }
+	  }
+	  else if (soft && pad < 0)
+	  {
+	    /* \0-terminate dest for length computation in mutt_wstr_trunc() */
+	    *st->wptr = 0;
+	    /* make sure right part is at most as wide as display */
+	    len = mutt_wstr_trunc (buf, st->destlen, COLS, &wid);
+	    /* truncate left so that right part fits completely in */
+	    st->wlen = mutt_wstr_trunc (st->dest, st->destlen - len,
+					st->col + pad, &st->col);
+	    st->wptr = st->dest + st->wlen;
+	  }
+	  if (len + st->wlen > st->destlen)
+	    len = mutt_wstr_trunc (buf, st->destlen - st->wlen, COLS - st->col, NULL);
+	  memcpy (st->wptr, buf, len);
+	  st->wptr += len;
+	  st->wlen += len;
+	  st->col += wid;
+	}
+	break;
+      }
+
+      case FMT_FILL:
+      {
+	/* pad to EOL */
+	int pl, pw, c;
+
+	if (op->optional)
+	  st->flags |= M_FORMAT_OPTIONAL;
+	else
+	  st->flags &= ~M_FORMAT_OPTIONAL;
+
+	if ((pl = mutt_charlen (src, &pw)) <= 0)
+	  pl = pw = 1;
+
+	/* see if there's room to add content, else ignore */
+	if (st->col < COLS && st->wlen < st->destlen)
+	{
+	  c = (COLS - st->col) / pw;
+	  if (c > 0 && st->wlen + (c * pl) > st->destlen)
+	    c = ((signed)(st->destlen - st->wlen)) / pl;
+	  while (c > 0)
+	  {
+	    memcpy (st->wptr, src, pl);
+	    st->wptr += pl;
+	    st->wlen += pl;
+	    st->col += pw;
+	    c--;
+	  }
+	}
+	break;
+      }
+
+      case FMT_EXPANDO:
+	if (op->optional)
+	  st->flags |= M_FORMAT_OPTIONAL;
+	else
+	  st->flags &= ~M_FORMAT_OPTIONAL;
+
+	/* use callback function to handle this case */
+	next = st->callback (buf, sizeof (buf), st->col, op->ch, src,
+			     NONULL (op->prefix), NONULL (op->ifstring),
+			     NONULL (op->elsestring), st->data, st->flags);
+
+	if (op->tolower)
+	  mutt_strlower (buf);
+	if (op->nodots)
+	{
+	  char *p = buf;
+	  for (; *p; p++)
+	    if (*p == '.')
+		*p = '_';
+	}
+
+	if ((len = mutt_strlen (buf)) + st->wlen > st->destlen)
+	  len = mutt_wstr_trunc (buf, st->destlen - st->wlen, COLS - st->col, NULL);
+
+	memcpy (st->wptr, buf, len);
+	st->wptr += len;
+	st->wlen += len;
+	st->col += mutt_strwidth (buf);
+
+	if (next == src)
+	  break;
+	if (!next || !*next)
+	  goto done;
+
+	/* The callback ate more of the template, e.g. the strftime() part
+	 * of %{...}.  Carry on with the op starting there, or with a
+	 * program for the rest of the template. */
+	if (next > src && next < prog->src + mutt_strlen (prog->src))
+	{
+	  off = next - prog->src;
+	  for (k = i + 1; k < prog->nops && prog->ops[k].start < off; k++)
+	    ;
+	  if (k < prog->nops && prog->ops[k].start == off)
+	  {
+	    i = k - 1;
+	    break;
+	  }
+
+	  if (!op->tail)
+	  {
+	    op->tail = format_compile (next, 0);
+	    op->tail_callback = st->callback;
+	    op->tail_off = off;
+	  }
+	  if (op->tail_callback == st->callback && op->tail_off == off)
+	  {
+	    format_run (op->tail, st);
+	    goto done;
+	  }
+	}
+
+	tail = format_compile (next, 0);
+	format_run (tail, st);
+	format_free (&tail);
+	goto done;
+    }
+  }
+
+done:
+  prog->busy--;
+}
+
 void mutt_FormatString (char *dest,		/* output buffer */
 			size_t destlen,		/* output buffer len */
 			size_t col,		/* starting column (nonzero when called recursively) */
@@ -1057,36 +1721,24 @@ void mutt_FormatString (char *dest,		/* output buffer */
 			unsigned long data,	/* callback data */
 			format_flag flags)	/* callback flags */
 {
-  char prefix[SHORT_STRING], buf[LONG_STRING], *cp, *wptr = dest, ch;
-  char ifstring[SHORT_STRING], elsestring[SHORT_STRING];
-  size_t wlen, count, len, wid;
+  char buf[LONG_STRING], *wptr = dest;
+  size_t wlen;
   pid_t pid;
   FILE *filter;
-  int n;
+  int n, temporary;
   char *recycler;
+  FORMAT_PROG *prog;
+  FORMAT_STATE st;
 
-  prefix[0] = '\0';
   destlen--; /* save room for the terminal \0 */
   wlen = (flags & M_FORMAT_ARROWCURSOR && option (OPTARROWCURSOR)) ? 3 : 0;
   col += wlen;
 
+  prog = format_lookup (src, &temporary);
+
   if ((flags & M_FORMAT_NOFILTER) == 0)
   {
-    int off = -1;
-
-    /* Do not consider filters if no pipe at end */
-    n = mutt_strlen(src);
-    if (n > 1 && src[n-1] == '|')
-    {
-      /* Scan backwards for backslashes */
-      off = n;
-      while (off > 0 && src[off-2] == '\\')
-        off--;
-    }
-
-    /* If number of backslashes is even, the pipe is real. */
-    /* n-off is the number of backslashes. */
-    if (off > 0 && ((n-off) % 2) == 0)
+    if (prog->filter)
     {
       BUFFER *srcbuf, *word, *command;
       char    srccopy[LONG_STRING];
@@ -1096,6 +1748,7 @@ void mutt_FormatString (char *dest,		/* output buffer */
 
       dprint(3, (debugfile, "fmtpipe = %s\n", src));
 
+      n = mutt_strlen (src);
       strncpy(srccopy, src, n);
       srccopy[n-1] = '\0';
 
@@ -1177,251 +1830,26 @@ void mutt_FormatString (char *dest,		/* output buffer */
       mutt_buffer_free(&command);
       mutt_buffer_free(&srcbuf);
       mutt_buffer_free(&word);
+      if (temporary)
+	format_free (&prog);
       return;
     }
   }
 
-  while (*src && wlen < destlen)
-  {
-    if (*src == '%')
-    {
-      if (*++src == '%')
-      {
-	*wptr++ = '%';
-	wlen++;
-	col++;
-	src++;
-	continue;
-      }
-
-      if (*src == '?')
-      {
-	flags |= M_FORMAT_OPTIONAL;
-	src++;
-      }
-      else
-      {
-	flags &= ~M_FORMAT_OPTIONAL;
-
-	/* eat the format string */
-	cp = prefix;
-	count = 0;
-	while (count < sizeof (prefix) &&
-	       (isdigit ((unsigned char) *src) || *src == '.' || *src == '-' || *src == '='))
-	{
-	  *cp++ = *src++;
-	  count++;
-	}
-	*cp = 0;
-      }
-
-      if (!*src)
-	break; /* bad format */
-
-      ch = *src++; /* save the character to switch on */
-
-      if (flags & M_FORMAT_OPTIONAL)
-      {
-        if (*src != '?')
-          break; /* bad format */
-        src++;
-
-        /* eat the `if' part of the string */
-        cp = ifstring;
-	count = 0;
-        while (count < sizeof (ifstring) && *src && *src != '?' && *src != '&')
-	{
-          *cp++ = *src++;
-	  count++;
-	}
-        *cp = 0;
-
-	/* eat the `else' part of the string (optional) */
-	if (*src == '&')
-	  src++; /* skip the & */
-	cp = elsestring;
-	count = 0;
-	while (count < sizeof (elsestring) && *src && *src != '?')
-	{
-	  *cp++ = *src++;
-	  count++;
-	}
-	*cp = 0;
-
-	if (!*src)
-	  break; /* bad format */
-
-        src++; /* move past the trailing `?' */
-      }
-
-      /* handle generic cases first */
-      if (ch == '>' || ch == '*')
-      {
-	/* %>X: right justify to EOL, left takes precedence
-	 * %*X: right justify to EOL, right takes precedence */
-	int soft = ch == '*';
-	int pl, pw;
-	if ((pl = mutt_charlen (src, &pw)) <= 0)
-	  pl = pw = 1;
-
-	/* see if there's room to add content, else ignore */
-	if ((col < COLS && wlen < destlen) || soft)
-	{
-	  int pad;
+  st.dest = dest;
+  st.wptr = wptr;
+  st.destlen = destlen;
+  st.wlen = wlen;
+  st.col = col;
+  st.callback = callback;
+  st.data = data;
+  st.flags = flags;
 
-	  /* get contents after padding */
-	  mutt_FormatString (buf, sizeof (buf), 0, src + pl, callback, data, flags);
-	  len = mutt_strlen (buf);
-	  wid = mutt_strwidth (buf);
+  format_run (prog, &st);
+  if (temporary)
+    format_free (&prog);
 
-	  /* try to consume as many columns as we can, if we don't have
-	   * memory for that, use as much memory as possible */
-	  pad = (COLS - col - wid) / pw;
-	  if (pad > 0 && wlen + (pad * pl) + len > destlen)
-	    pad = ((signed)(destlen - wlen - len)) / pl;
-	  if (pad > 0)
-	  {
-	    while (pad--)
-	    {
-	      memcpy (wptr, src, pl);
-	      wptr += pl;
-	      wlen += pl;
-	      col += pw;
-	    }
-	  }
-	  else if (soft && pad < 0)
-	  {
-	    /* \0-terminate dest for length computation in mutt_wstr_trunc() */
-	    *wptr = 0;
-	    /* make sure right part is at most as wide as display */
-	    len = mutt_wstr_trunc (buf, destlen, COLS, &wid);
-	    /* truncate left so that right part fits completely in */
-	    wlen = mutt_wstr_trunc (dest, destlen - len, col + pad, &col);
-	    wptr = dest + wlen;
-	  }
-	  if (len + wlen > destlen)
-	    len = mutt_wstr_trunc (buf, destlen - wlen, COLS - col, NULL);
-	  memcpy (wptr, buf, len);
-	  wptr += len;
-	  wlen += len;
-	  col += wid;
-	  src += pl;
-	}
-	break; /* skip rest of input */
-      }
-      else if (ch == '|')
-      {
-	/* pad to EOL */
-	int pl, pw, c;
-	if ((pl = mutt_charlen (src, &pw)) <= 0)
-	  pl = pw = 1;
-
-	/* see if there's room to add content, else ignore */
-	if (col < COLS && wlen < destlen)
-	{
-	  c = (COLS - col) / pw;
-	  if (c > 0 && wlen + (c * pl) > destlen)
-	    c = ((signed)(destlen - wlen)) / pl;
-	  while (c > 0)
-	  {
-	    memcpy (wptr, src, pl);
-	    wptr += pl;
-	    wlen += pl;
-	    col += pw;
-	    c--;
-	  }
-	  src += pl;
-	}
-	break; /* skip rest of input */
-      }
-      else
-      {
-	short tolower =  0;
-	short nodots  = 0;
-	
-	while (ch == '_' || ch == ':') 
-	{
-	  if (ch == '_')
-	    tolower = 1;
-	  else if (ch == ':') 
-	    nodots = 1;
-	  
-	  ch = *src++;
-	}
-	
-	/* use callback function to handle this case */
-	src = callback (buf, sizeof (buf), col, ch, src, prefix, ifstring, elsestring, data, flags);
-
-	if (tolower)
-	  mutt_strlower (buf);
-	if (nodots) 
-	{
-	  char *p = buf;
-	  for (; *p; p++)
-	    if (*p == '.')
-		*p = '_';
-	}
-	
-	if ((len = mutt_strlen (buf)) + wlen > destlen)
-	  len = mutt_wstr_trunc (buf, destlen - wlen, COLS - col, NULL);
-
-	memcpy (wptr, buf, len);
-	wptr += len;
-	wlen += len;
-	col += mutt_strwidth (buf);
-      }
-    }
-    else if (*src == '\\')
-    {
-      if (!*++src)
-	break;
-      switch (*src)
-      {
-	case 'n':
-	  *wptr = '\n';
-	  break;
-	case 't':
-	  *wptr = '\t';
-	  break;
-	case 'r':
-	  *wptr = '\r';
-	  break;
-	case 'f':
-	  *wptr = '\f';
-	  break;
-	case 'v':
-	  *wptr = '\v';
-	  break;
-	default:
-	  *wptr = *src;
-	  break;
-      }
-      src++;
-      wptr++;
-      wlen++;
-      col++;
-    }
-    else
-    {
-      int tmp, w;
-      /* in case of error, simply copy byte */
-      if ((tmp = mutt_charlen (src, &w)) < 0)
-	tmp = w = 1;
-      if (tmp > 0 && wlen + tmp < destlen)
-      {
-        memcpy (wptr, src, tmp);
-        wptr += tmp;
-        src += tmp;
-        wlen += tmp;
-        col += w;
-      }
-      else
-      {
-	src += destlen - wlen;
-	wlen = destlen;
-      }
-    }
-  }
+  wptr = st.wptr;
   *wptr = 0;
 
 #if 0
@@ -1607,6 +2035,126 @@ int state_putws (const wchar_t *ws, STATE *s)
   return 0;
 }
 
+static int state_sink_spill (STATE_SINK *sink)
+{
+  char tempfile[_POSIX_PATH_MAX];
+
+  mutt_mktemp (tempfile, sizeof (tempfile));
+  if ((sink->spill = safe_fopen (tempfile, "w+")) == NULL)
+  {
+    mutt_perror (tempfile);
+    return -1;
+  }
+  sink->tempfile = safe_strdup (tempfile);
+
+  if (sink->len && fwrite (sink->buf, 1, sink->len, sink->spill) != sink->len)
+    return -1;
+  FREE (&sink->buf);
+  sink->size = 0;
+  return 0;
+}
+
+#if defined(HAVE_FOPENCOOKIE) && defined(HAVE_FMEMOPEN)
+static ssize_t state_sink_write (void *cookie, const char *data, size_t n)
+{
+  STATE_SINK *sink = (STATE_SINK *) cookie;
+
+  if (!sink->spill && sink->len + n > sink->limit &&
+      state_sink_spill (sink) == -1)
+    return -1;
+
+  if (sink->spill)
+  {
+    if (fwrite (data, 1, n, sink->spill) != n)
+      return -1;
+  }
+  else
+  {
+    if (sink->len + n > sink->size)
+    {
+      sink->size = MAX (sink->len + n, 2 * sink->size);
+      safe_realloc (&sink->buf, sink->size);
+    }
+    memcpy (sink->buf + sink->len, data, n);
+  }
+
+  sink->len += n;
+  return n;
+}
+#endif
+
+/*
+ * Open sink->fp for output.  The output is kept in memory until it grows
+ * past $thorough_search_memory, and is then moved to a temporary file.
+ * size is what the output is expected to be, if that is already too
+ * large the temporary file is used right away.  Returns 0 on success.
+ */
+int state_sink_open (STATE_SINK *sink, LOFF_T size)
+{
+#if defined(HAVE_FOPENCOOKIE) && defined(HAVE_FMEMOPEN)
+  cookie_io_functions_t io = { NULL, state_sink_write, NULL, NULL };
+#endif
+
+  memset (sink, 0, sizeof (STATE_SINK));
+  sink->limit = (size_t) MAX (SearchMemory, 0) * 1024;
+
+#if defined(HAVE_FOPENCOOKIE) && defined(HAVE_FMEMOPEN)
+  if (size <= (LOFF_T) sink->limit &&
+      (sink->fp = fopencookie (sink, "w", io)) != NULL)
+    return 0;
+#endif
+
+  if (state_sink_spill (sink) == -1)
+    return -1;
+  sink->fp = sink->spill;
+  return 0;
+}
+
+/*
+ * Switch sink->fp to reading what has been written, from the start.
+ * Returns the number of bytes written.  sink->fp is NULL if there are
+ * none.
+ */
+LOFF_T state_sink_rewind (STATE_SINK *sink)
+{
+  struct stat st;
+
+  /* flushes whatever the memory stream still buffers, maybe to spill */
+  if (sink->fp != sink->spill)
+    safe_fclose (&sink->fp);
+
+  if (sink->spill)
+  {
+    sink->fp = sink->spill;
+    fflush (sink->fp);
+    rewind (sink->fp);
+    if (fstat (fileno (sink->fp), &st) == -1)
+      return 0;
+    return st.st_size;
+  }
+
+#ifdef HAVE_FMEMOPEN
+  if (sink->len)
+    sink->fp = fmemopen (sink->buf, sink->len, "r");
+#endif
+  return sink->fp ? sink->len : 0;
+}
+
+void state_sink_close (STATE_SINK *sink)
+{
+  if (sink->fp != sink->spill)
+    safe_fclose (&sink->fp);
+  safe_fclose (&sink->spill);
+  sink->fp = NULL;
+  if (sink->tempfile)
+  {
+    unlink (sink->tempfile);
+    FREE (&sink->tempfile);
+  }
+  FREE (&sink->buf);
+  sink->len = 0;
+}
+
 void mutt_display_sanitize (char *s)
 {
   for (; *s; s++)
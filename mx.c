@@ -578,6 +578,8 @@ static int mx_open_mailbox_append (CONTEXT *ctx, int flags)
  * Args:
  *	flags	M_NOSORT	do not sort mailbox
  *		M_APPEND	open mailbox for appending
+ *		M_PROGRESSIVE	only read the first messages of an mbox
+ *				folder if $progressive_open is set
  *		M_READONLY	open mailbox in read-only mode
  *		M_QUIET		only print error messages
  *	ctx	if non-null, context struct to use
@@ -653,6 +655,8 @@ CONTEXT *mx_open_mailbox (const char *path, int flags, CONTEXT *pctx)
 
     case M_MMDF:
     case M_MBOX:
+      if ((flags & M_PROGRESSIVE) && option (OPTPROGRESSIVEOPEN))
+	ctx->loading = 1;
       rc = mbox_open_mailbox (ctx);
       break;
 
@@ -680,6 +684,10 @@ CONTEXT *mx_open_mailbox (const char *path, int flags, CONTEXT *pctx)
       /* avoid unnecessary work since the mailbox is completely unthreaded
 	 to begin with */
       unset_option (OPTSORTSUBTHREADS);
+      /* every message was scored against the current rules while it was
+       * read, this merely forgets about earlier changes to them */
+      if (option (OPTSCORE))
+	mutt_rescore_context (ctx);
       unset_option (OPTNEEDRESCORE);
       mutt_sort_headers (ctx, 1);
     }
@@ -697,6 +705,63 @@ CONTEXT *mx_open_mailbox (const char *path, int flags, CONTEXT *pctx)
   return (ctx);
 }
 
+static int mx_read_more (CONTEXT *ctx, int all)
+{
+  int quiet = ctx->quiet;
+  int rc;
+
+  if (!ctx->loading)
+    return 0;
+
+  ctx->quiet = 1;
+  rc = mbox_open_more (ctx, all);
+  ctx->quiet = quiet;
+
+  if (rc == -1)
+  {
+    /* writing back what we have would lose the rest of the mailbox */
+    ctx->loading = 0;
+    ctx->readonly = 1;
+    return -1;
+  }
+
+  return rc;
+}
+
+/* read the next part of a mailbox opened with M_PROGRESSIVE, without
+ * waiting for a lock.  Returns 0, M_REOPENED if the mailbox changed and
+ * was read again in full, -2 if the mailbox is locked and the caller
+ * should try again later, or -1 if the rest of the mailbox couldn't be
+ * read; it is then made read-only.
+ */
+int mx_open_more (CONTEXT *ctx)
+{
+  return mx_read_more (ctx, 0);
+}
+
+/* read whatever is left of a mailbox opened with M_PROGRESSIVE.  Returns
+ * M_REOPENED like mx_open_more(), or -1 if that wasn't possible; unless
+ * ctx->readonly got set, the mailbox was only locked and the rest can
+ * still be read later.
+ */
+int mx_open_finish (CONTEXT *ctx)
+{
+  int rc = 0;
+
+  if (!ctx->loading)
+    return 0;
+
+  if (!ctx->quiet)
+    mutt_message (_("Reading %s..."), ctx->path);
+  while (ctx->loading && rc >= 0)
+    rc = mx_read_more (ctx, 1);
+  if (rc < 0)
+    return -1;
+  if (!ctx->quiet)
+    mutt_clear_error ();
+  return rc;
+}
+
 /* free up memory associated with the mailbox context */
 void mx_fastclose_mailbox (CONTEXT *ctx)
 {
@@ -807,6 +872,18 @@ int mx_close_mailbox (CONTEXT *ctx, int *index_hint)
     return 0;
   }
 
+  if (mx_open_finish (ctx) < 0)
+  {
+    if (!ctx->readonly)
+    {
+      ctx->closing = 0;
+      return (-1);
+    }
+    /* the rest was modified, there is nothing we can safely write */
+    mx_fastclose_mailbox (ctx);
+    return 0;
+  }
+
   for (i = 0; i < ctx->msgcount; i++)
   {
     if (!ctx->hdrs[i]->deleted && ctx->hdrs[i]->read 
@@ -994,6 +1071,7 @@ void mx_update_tables(CONTEXT *ctx, int committing)
   int i, j;
   
   /* update memory to reflect the new state of the mailbox */
+  mutt_invalidate_index_lines ();
   ctx->vcount = 0;
   ctx->vsize = 0;
   ctx->tagged = 0;
@@ -1096,6 +1174,13 @@ int mx_sync_mailbox (CONTEXT *ctx, int *index_hint)
     return -1;
   }
 
+  if (mx_open_finish (ctx) < 0)
+  {
+    if (ctx->readonly)
+      mutt_error _("Mailbox is read-only.");
+    return -1;
+  }
+
   if (!ctx->changed && !ctx->deleted)
   {
     if (!ctx->quiet)
@@ -1528,6 +1613,9 @@ void mx_update_context (CONTEXT *ctx, int new_messages)
   HEADER *h;
   int msgno;
 
+  /* %m and the thread counts in $index_format change */
+  mutt_invalidate_index_lines ();
+
   for (msgno = ctx->msgcount - new_messages; msgno < ctx->msgcount; msgno++)
   {
     h = ctx->hdrs[msgno];
@@ -45,6 +45,7 @@ WHERE short DefaultMagic INITVAL (M_MBOX);
 
 int mbox_sync_mailbox (CONTEXT *, int *);
 int mbox_open_mailbox (CONTEXT *);
+int mbox_open_more (CONTEXT *, int);
 int mbox_check_mailbox (CONTEXT *, int *);
 int mbox_close_mailbox (CONTEXT *);
 int mbox_lock_mailbox (CONTEXT *, int, int);
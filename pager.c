@@ -33,6 +33,9 @@
 #include "mutt_crypt.h"
 
 #include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <ctype.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -93,6 +96,20 @@ struct q_class_t
   struct q_class_t *down, *up;
 };
 
+/* quote prefixes by character, for finding their classes */
+struct q_trie_t
+{
+  unsigned char c;
+  struct q_class_t *class;	/* class of the prefix ending here, if any */
+  struct q_trie_t *child, *next;
+};
+
+struct q_list_t
+{
+  struct q_class_t *top;	/* top level classes */
+  struct q_trie_t trie;		/* the empty prefix */
+};
+
 struct syntax_t
 {
   int color;
@@ -107,11 +124,22 @@ struct line_t
   short continuation;
   short chunks;
   short search_cnt;
+  short colored;		/* body patterns have been applied */
   struct syntax_t *syntax;
   struct syntax_t *search;
   struct q_class_t *quote;
 };
 
+/* the file being paged, mapped into memory if possible */
+#define PAGER_LAYOUT_CHUNK 256	/* lines laid out between input checks */
+
+struct pager_file_t
+{
+  FILE *fp;
+  char *map;
+  size_t len;
+};
+
 #define ANSI_OFF       (1<<0)
 #define ANSI_BLINK     (1<<1)
 #define ANSI_BOLD      (1<<2)
@@ -367,14 +395,14 @@ shift_class_colors (struct q_class_t *QuoteList, struct q_class_t *new_class,
 }
 
 static void
-cleanup_quote (struct q_class_t **QuoteList)
+cleanup_classes (struct q_class_t **QuoteList)
 {
   struct q_class_t *ptr;
 
   while (*QuoteList)
   {
     if ((*QuoteList)->down)
-      cleanup_quote (&((*QuoteList)->down));
+      cleanup_classes (&((*QuoteList)->down));
     ptr = (*QuoteList)->next;
     if ((*QuoteList)->prefix)
       FREE (&(*QuoteList)->prefix);
@@ -385,313 +413,140 @@ cleanup_quote (struct q_class_t **QuoteList)
   return;
 }
 
+static void
+cleanup_trie (struct q_trie_t **trie)
+{
+  struct q_trie_t *ptr;
+
+  while (*trie)
+  {
+    if ((*trie)->child)
+      cleanup_trie (&((*trie)->child));
+    ptr = (*trie)->next;
+    FREE (trie);		/* __FREE_CHECKED__ */
+    *trie = ptr;
+  }
+}
+
+static void
+cleanup_quote (struct q_list_t *QuoteList)
+{
+  cleanup_classes (&QuoteList->top);
+  cleanup_trie (&QuoteList->trie.child);
+}
+
 static struct q_class_t *
-classify_quote (struct q_class_t **QuoteList, const char *qptr,
+classify_quote (struct q_list_t *QuoteList, const char *qptr,
 		int length, int *force_redraw, int *q_level)
 {
-  struct q_class_t *q_list = *QuoteList;
-  struct q_class_t *class = NULL, *tmp = NULL, *ptr, *save;
-  char *tail_qptr;
-  int offset, tail_lng;
-  int index = -1;
+  struct q_class_t *class, *parent = NULL, *q_list, *last = NULL, *save;
+  struct q_class_t **siblings;
+  struct q_trie_t *node, *child;
+  int i, index = -1;
 
   if (ColorQuoteUsed <= 1)
   {
     /* not much point in classifying quotes... */
 
-    if (*QuoteList == NULL)
+    if (QuoteList->top == NULL)
     {
       class = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
       class->color = ColorQuote[0];
-      *QuoteList = class;
+      QuoteList->top = class;
     }
-    return (*QuoteList);
+    return (QuoteList->top);
   }
 
-  /* Did I mention how much I like emulating Lisp in C? */
-
-  /* classify quoting prefix */
-  while (q_list)
+  /* look the prefix up in the trie, the last class on the way there is
+   * the parent of a new class */
+  node = &QuoteList->trie;
+  for (i = 0; i < length; i++)
   {
-    if (length <= q_list->length)
-    {
-      /* case 1: check the top level nodes */
-
-      if (mutt_strncmp (qptr, q_list->prefix, length) == 0)
-      {
-	if (length == q_list->length)
-	  return q_list;	/* same prefix: return the current class */
-
-	/* found shorter prefix */
-	if (tmp == NULL)
-	{
-	  /* add a node above q_list */
-	  tmp = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
-	  tmp->prefix = (char *) safe_calloc (1, length + 1);
-	  strncpy (tmp->prefix, qptr, length);
-	  tmp->length = length;
-
-	  /* replace q_list by tmp in the top level list */
-	  if (q_list->next)
-	  {
-	    tmp->next = q_list->next;
-	    q_list->next->prev = tmp;
-	  }
-	  if (q_list->prev)
-	  {
-	    tmp->prev = q_list->prev;
-	    q_list->prev->next = tmp;
-	  }
-
-	  /* make q_list a child of tmp */
-	  tmp->down = q_list;
-	  q_list->up = tmp;
+    if (node->class)
+      parent = node->class;
 
-	  /* q_list has no siblings for now */
-	  q_list->next = NULL;
-	  q_list->prev = NULL;
+    for (child = node->child; child; child = child->next)
+      if (child->c == (unsigned char) qptr[i])
+	break;
+    if (!child)
+    {
+      child = (struct q_trie_t *) safe_calloc (1, sizeof (struct q_trie_t));
+      child->c = (unsigned char) qptr[i];
+      child->next = node->child;
+      node->child = child;
+    }
+    node = child;
+  }
 
-	  /* update the root if necessary */
-	  if (q_list == *QuoteList)
-	    *QuoteList = tmp;
+  if (node->class)
+    return node->class;	/* same prefix: return its class */
 
-	  index = q_list->index;
+  class = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
+  class->prefix = (char *) safe_calloc (1, length + 1);
+  strncpy (class->prefix, qptr, length);
+  class->length = length;
+  class->up = parent;
+  node->class = class;
 
-	  /* tmp should be the return class too */
-	  class = tmp;
+  /* the classes of longer prefixes below parent become children of the
+   * new class, which takes the place of the first of them */
+  siblings = parent ? &parent->down : &QuoteList->top;
+  for (q_list = *siblings; q_list; q_list = save)
+  {
+    save = q_list->next;
 
-	  /* next class to test; if tmp is a shorter prefix for another
-	   * node, that node can only be in the top level list, so don't
-	   * go down after this point
-	   */
-	  q_list = tmp->next;
-	}
-	else
-	{
-	  /* found another branch for which tmp is a shorter prefix */
-
-	  /* save the next sibling for later */
-	  save = q_list->next;
-
-	  /* unlink q_list from the top level list */
-	  if (q_list->next)
-	    q_list->next->prev = q_list->prev;
-	  if (q_list->prev)
-	    q_list->prev->next = q_list->next;
-
-	  /* at this point, we have a tmp->down; link q_list to it */
-	  ptr = tmp->down;
-	  /* sibling order is important here, q_list should be linked last */
-	  while (ptr->next)
-	    ptr = ptr->next;
-	  ptr->next = q_list;
-	  q_list->next = NULL;
-	  q_list->prev = ptr;
-	  q_list->up = tmp;
-
-	  index = q_list->index;
-
-	  /* next class to test; as above, we shouldn't go down */
-	  q_list = save;
-	}
+    if (q_list->length <= length ||
+	strncmp (qptr, q_list->prefix, length) != 0)
+      continue;
 
-	/* we found a shorter prefix, so certain quotes have changed classes */
-	*force_redraw = 1;
-	continue;
-      }
+    if (last == NULL)
+    {
+      class->next = q_list->next;
+      class->prev = q_list->prev;
+      if (q_list->next)
+	q_list->next->prev = class;
+      if (q_list->prev)
+	q_list->prev->next = class;
       else
-      {
-	/* shorter, but not a substring of the current class: try next */
-	q_list = q_list->next;
-	continue;
-      }
+	*siblings = class;
+      class->down = q_list;
+      q_list->prev = NULL;
     }
     else
     {
-      /* case 2: try subclassing the current top level node */
-      
-      /* tmp != NULL means we already found a shorter prefix at case 1 */
-      if (tmp == NULL && mutt_strncmp (qptr, q_list->prefix, q_list->length) == 0)
-      {
-	/* ok, it's a subclass somewhere on this branch */
-
-	ptr = q_list;
-	offset = q_list->length;
-
-	q_list = q_list->down;
-	tail_lng = length - offset;
-	tail_qptr = (char *) qptr + offset;
-
-	while (q_list)
-	{
-	  if (length <= q_list->length)
-	  {
-	    if (mutt_strncmp (tail_qptr, (q_list->prefix) + offset, tail_lng) == 0)
-	    {
-	      /* same prefix: return the current class */
-	      if (length == q_list->length)
-		return q_list;
-
-	      /* found shorter common prefix */
-	      if (tmp == NULL)
-	      {
-		/* add a node above q_list */
-		tmp = (struct q_class_t *) safe_calloc (1, 
-					    sizeof (struct q_class_t));
-		tmp->prefix = (char *) safe_calloc (1, length + 1);
-		strncpy (tmp->prefix, qptr, length);
-		tmp->length = length;
-			
-		/* replace q_list by tmp */
-		if (q_list->next)
-		{
-		  tmp->next = q_list->next;
-		  q_list->next->prev = tmp;
-		}
-		if (q_list->prev)
-		{
-		  tmp->prev = q_list->prev;
-		  q_list->prev->next = tmp;
-		}
-
-		/* make q_list a child of tmp */
-		tmp->down = q_list;
-		tmp->up = q_list->up;
-		q_list->up = tmp;
-		if (tmp->up->down == q_list)
-		  tmp->up->down = tmp;
-
-		/* q_list has no siblings */
-		q_list->next = NULL;
-		q_list->prev = NULL;
-                              
-		index = q_list->index;
-
-		/* tmp should be the return class too */
-		class = tmp;
-
-		/* next class to test */
-		q_list = tmp->next;
-	      }
-	      else
-	      {
-		/* found another branch for which tmp is a shorter prefix */
-
-		/* save the next sibling for later */
-		save = q_list->next;
-
-		/* unlink q_list from the top level list */
-		if (q_list->next)
-		  q_list->next->prev = q_list->prev;
-		if (q_list->prev)
-		  q_list->prev->next = q_list->next;
-
-		/* at this point, we have a tmp->down; link q_list to it */
-		ptr = tmp->down;
-		while (ptr->next)
-		  ptr = ptr->next;
-		ptr->next = q_list;
-		q_list->next = NULL;
-		q_list->prev = ptr;
-		q_list->up = tmp;
-
-		index = q_list->index;
-
-		/* next class to test */
-		q_list = save;
-	      }
-
-	      /* we found a shorter prefix, so we need a redraw */
-	      *force_redraw = 1;
-	      continue;
-	    }
-	    else
-	    {
-	      q_list = q_list->next;
-	      continue;
-	    }
-	  }
-	  else
-	  {
-	    /* longer than the current prefix: try subclassing it */
-	    if (tmp == NULL && mutt_strncmp (tail_qptr, (q_list->prefix) + offset,
-			  q_list->length - offset) == 0)
-	    {
-	      /* still a subclass: go down one level */
-	      ptr = q_list;
-	      offset = q_list->length;
-
-	      q_list = q_list->down;
-	      tail_lng = length - offset;
-	      tail_qptr = (char *) qptr + offset;
-
-	      continue;
-	    }
-	    else
-	    {
-	      /* nope, try the next prefix */
-	      q_list = q_list->next;
-	      continue;
-	    }
-	  }
-	}
-
-	/* still not found so far: add it as a sibling to the current node */
-	if (class == NULL)
-	{
-	  tmp = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
-	  tmp->prefix = (char *) safe_calloc (1, length + 1);
-	  strncpy (tmp->prefix, qptr, length);
-	  tmp->length = length;
-
-	  if (ptr->down)
-	  {
-	    tmp->next = ptr->down;
-	    ptr->down->prev = tmp;
-	  }
-	  ptr->down = tmp;
-	  tmp->up = ptr;
-
-	  new_class_color (tmp, q_level);
-
-	  return tmp;
-	}
-	else
-	{
-	  if (index != -1)
-	    shift_class_colors (*QuoteList, tmp, index, q_level);
-
-	  return class;
-	}
-      }
-      else
-      {
-	/* nope, try the next prefix */
-	q_list = q_list->next;
-	continue;
-      }
+      /* unlink q_list and link it last below the new class */
+      if (q_list->next)
+	q_list->next->prev = q_list->prev;
+      if (q_list->prev)
+	q_list->prev->next = q_list->next;
+      last->next = q_list;
+      q_list->prev = last;
     }
+    q_list->next = NULL;
+    q_list->up = class;
+    last = q_list;
+
+    index = q_list->index;
   }
 
-  if (class == NULL)
+  if (index != -1)
   {
-    /* not found so far: add it as a top level class */
-    class = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
-    class->prefix = (char *) safe_calloc (1, length + 1);
-    strncpy (class->prefix, qptr, length);
-    class->length = length;
-    new_class_color (class, q_level);
-
-    if (*QuoteList)
+    /* we found a shorter prefix, so certain quotes have changed classes */
+    *force_redraw = 1;
+    shift_class_colors (QuoteList->top, class, index, q_level);
+  }
+  else
+  {
+    /* add it as a sibling */
+    if (*siblings)
     {
-      class->next = *QuoteList;
-      (*QuoteList)->prev = class;
+      class->next = *siblings;
+      (*siblings)->prev = class;
     }
-    *QuoteList = class;
-  }
+    *siblings = class;
 
-  if (index != -1)
-    shift_class_colors (*QuoteList, tmp, index, q_level);
+    new_class_color (class, q_level);
+  }
 
   return class;
 }
@@ -700,15 +555,16 @@ static int brailleLine = -1;
 static int brailleCol = -1;
 
 static int check_attachment_marker (char *);
+static void resolve_body_colors (char *, struct line_t *, int);
 
 static void
 resolve_types (char *buf, char *raw, struct line_t *lineInfo, int n, int last,
-		struct q_class_t **QuoteList, int *q_level, int *force_redraw,
+		struct q_list_t *QuoteList, int *q_level, int *force_redraw,
 		int q_classify)
 {
   COLOR_LINE *color_line;
   regmatch_t pmatch[1], smatch[1];
-  int found, offset, null_rx, i;
+  int i;
 
   if (n == 0 || ISHEADER (lineInfo[n-1].type))
   {
@@ -808,7 +664,22 @@ resolve_types (char *buf, char *raw, struct line_t *lineInfo, int n, int last,
   else
     lineInfo[n].type = MT_COLOR_NORMAL;
 
-  /* body patterns */
+  /* body patterns are applied only when the line is displayed */
+  lineInfo[n].colored = 0;
+  if (q_classify)
+    resolve_body_colors (buf, lineInfo, n);
+}
+
+/* apply the body color patterns to line n, buf is its text */
+static void
+resolve_body_colors (char *buf, struct line_t *lineInfo, int n)
+{
+  COLOR_LINE *color_line;
+  regmatch_t pmatch[1];
+  int found, offset, null_rx, i;
+
+  lineInfo[n].colored = 1;
+
   if (lineInfo[n].type == MT_COLOR_NORMAL || 
       lineInfo[n].type == MT_COLOR_QUOTED)
   {
@@ -996,8 +867,9 @@ trim_incomplete_mbyte(unsigned char *buf, size_t len)
 }
 
 static int
-fill_buffer (FILE *f, LOFF_T *last_pos, LOFF_T offset, unsigned char **buf,
-	     unsigned char **fmt, size_t *blen, int *buf_ready)
+fill_buffer (struct pager_file_t *pf, LOFF_T *last_pos, LOFF_T offset,
+	     unsigned char **buf, unsigned char **fmt, size_t *blen,
+	     int *buf_ready)
 {
   unsigned char *p, *q;
   static int b_read;
@@ -1005,14 +877,39 @@ fill_buffer (FILE *f, LOFF_T *last_pos, LOFF_T offset, unsigned char **buf,
 
   if (*buf_ready == 0)
   {
-    if (offset != *last_pos)
-      fseeko (f, offset, 0);
-    if ((*buf = (unsigned char *) mutt_read_line ((char *) *buf, blen, f, &l, M_EOL)) == NULL)
+    if (pf->map)
     {
-      fmt[0] = 0;
-      return (-1);
+      /* find the end of the line in the mapped file */
+      if (offset >= pf->len)
+      {
+	fmt[0] = 0;
+	return (-1);
+      }
+      p = (unsigned char *) pf->map + offset;
+      if ((q = memchr (p, '\n', pf->len - offset)) != NULL)
+	l = q - p + 1;
+      else
+	l = pf->len - offset;
+      if (!*buf || *blen < l + 1)
+      {
+	*blen = MAX (l + 1, STRING);
+	safe_realloc (buf, *blen);
+      }
+      memcpy (*buf, p, l);
+      (*buf)[l] = 0;
+      *last_pos = offset + l;
+    }
+    else
+    {
+      if (offset != *last_pos)
+	fseeko (pf->fp, offset, 0);
+      if ((*buf = (unsigned char *) mutt_read_line ((char *) *buf, blen, pf->fp, &l, M_EOL)) == NULL)
+      {
+	fmt[0] = 0;
+	return (-1);
+      }
+      *last_pos = ftello (pf->fp);
     }
-    *last_pos = ftello (f);
     b_read = (int) (*last_pos - offset);
     *buf_ready = 1;
 
@@ -1237,9 +1134,10 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
  */
 
 static int
-display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n, 
-	      int *last, int *max, int flags, struct q_class_t **QuoteList,
-	      int *q_level, int *force_redraw, regex_t *SearchRE)
+display_line (struct pager_file_t *pf, LOFF_T *last_pos, struct line_t **lineInfo, int n, 
+	      int *last, int *max, int flags, struct q_list_t *QuoteList,
+	      int *q_level, int *force_redraw, regex_t *SearchRE,
+	      PREFILTER *SearchPrefilter)
 {
   unsigned char *buf = NULL, *fmt = NULL;
   size_t buflen = 0;
@@ -1273,13 +1171,32 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
     }
   }
 
+  /* apply the body patterns to lines which were laid out without being
+   * displayed, continuation lines use the patterns of their first line */
+  if ((flags & M_SHOWCOLOR) && (*lineInfo)[n].type != -1)
+  {
+    m = (*lineInfo)[n].continuation ? ((*lineInfo)[n].syntax)[0].first : n;
+    if (!(*lineInfo)[m].colored)
+    {
+      unsigned char *mbuf = NULL, *mfmt = NULL;
+      size_t mbuflen = 0;
+      int mbuf_ready = 0;
+
+      if (fill_buffer (pf, last_pos, (*lineInfo)[m].offset, &mbuf, &mfmt,
+		       &mbuflen, &mbuf_ready) >= 0)
+	resolve_body_colors ((char *) mfmt, *lineInfo, m);
+      FREE (&mbuf);
+      FREE (&mfmt);
+    }
+  }
+
   /* only do color hiliting if we are viewing a message */
   if (flags & (M_SHOWCOLOR | M_TYPES))
   {
     if ((*lineInfo)[n].type == -1)
     {
       /* determine the line class */
-      if (fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
+      if (fill_buffer (pf, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
       {
 	if (change_last)
 	  (*last)--;
@@ -1308,7 +1225,7 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
   if ((flags & M_SHOWCOLOR) && !(*lineInfo)[n].continuation &&
       (*lineInfo)[n].type == MT_COLOR_QUOTED && (*lineInfo)[n].quote == NULL)
   {
-    if (fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
+    if (fill_buffer (pf, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
     {
       if (change_last)
 	(*last)--;
@@ -1323,7 +1240,7 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
 
   if ((flags & M_SEARCH) && !(*lineInfo)[n].continuation && (*lineInfo)[n].search_cnt == -1) 
   {
-    if (fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
+    if (fill_buffer (pf, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
     {
       if (change_last)
 	(*last)--;
@@ -1332,7 +1249,8 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
 
     offset = 0;
     (*lineInfo)[n].search_cnt = 0;
-    while (regexec (SearchRE, (char *) fmt + offset, 1, pmatch, (offset ? REG_NOTBOL : 0)) == 0)
+    while (mutt_prefilter_regexec (SearchRE, SearchPrefilter, (char *) fmt + offset,
+				   1, pmatch, (offset ? REG_NOTBOL : 0)) == 0)
     {
       if (++((*lineInfo)[n].search_cnt) > 1)
 	safe_realloc (&((*lineInfo)[n].search),
@@ -1366,7 +1284,7 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
     goto out; /* fake display */
   }
 
-  if ((b_read = fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt, 
+  if ((b_read = fill_buffer (pf, last_pos, (*lineInfo)[n].offset, &buf, &fmt, 
 			     &buflen, &buf_ready)) < 0)
   {
     if (change_last)
@@ -1501,6 +1419,210 @@ upNLines (int nlines, struct line_t *info, int cur, int hiding)
   return cur;
 }
 
+/* Lines of the message which match the current search, found by scanning
+ * the file from the top.  The scan is done in steps, so it can be
+ * interrupted and picked up again while the pager is idle. */
+struct search_index_t
+{
+  LOFF_T *hits;		/* offsets of the matching lines, ascending */
+  int count;
+  int max;
+  LOFF_T scanned;	/* the file has been searched up to here */
+  LOFF_T special;	/* next backspace or escape, -1 if not known */
+  unsigned char *buf;
+  unsigned char *fmt;
+  size_t blen;
+};
+
+#define SEARCH_CHUNK (256 * 1024)	/* bytes searched between input checks */
+
+static void search_reset (struct search_index_t *si)
+{
+  FREE (&si->hits);
+  FREE (&si->buf);
+  FREE (&si->fmt);
+  si->count = si->max = 0;
+  si->blen = 0;
+  si->scanned = 0;
+  si->special = -1;
+}
+
+/* Search the next part of the file.  In a mapped file the prefilter is
+ * run over the raw text to skip the lines which can't match.  Lines with
+ * backspaces or escapes are always checked, since fill_buffer() removes
+ * them before the expression sees the text. */
+static void
+search_scan (struct pager_file_t *pf, LOFF_T *last_pos, LOFF_T size,
+	     struct search_index_t *si, regex_t *SearchRE,
+	     PREFILTER *SearchPrefilter)
+{
+  LOFF_T pos = si->scanned, stop = si->scanned + SEARCH_CHUNK, p;
+  regmatch_t pmatch[1];
+  const char *s, *b, *e;
+  int buf_ready;
+
+  while (pos < size && pos < stop)
+  {
+    if (pf->map && SearchPrefilter)
+    {
+      if (si->special < pos)
+      {
+	b = memchr (pf->map + pos, '\010', pf->len - pos);
+	e = memchr (pf->map + pos, '\033', pf->len - pos);
+	if (b && (!e || b < e))
+	  si->special = b - pf->map;
+	else if (e)
+	  si->special = e - pf->map;
+	else
+	  si->special = pf->len;
+      }
+
+      if ((s = mutt_prefilter_find (SearchPrefilter, pf->map + pos,
+				    si->special - pos)) != NULL)
+	p = s - pf->map;
+      else if (si->special < pf->len)
+	p = si->special;
+      else
+      {
+	pos = size;
+	break;
+      }
+
+      /* back up to the start of the line */
+      while (p > pos && pf->map[p - 1] != '\n')
+	p--;
+      pos = p;
+    }
+
+    buf_ready = 0;
+    if (fill_buffer (pf, last_pos, pos, &si->buf, &si->fmt, &si->blen,
+		     &buf_ready) < 0)
+    {
+      pos = size;
+      break;
+    }
+    if (mutt_prefilter_regexec (SearchRE, SearchPrefilter, (char *) si->fmt,
+				1, pmatch, 0) == 0)
+    {
+      if (si->count == si->max)
+	safe_realloc (&si->hits, sizeof (LOFF_T) * (si->max += 256));
+      si->hits[si->count++] = pos;
+    }
+    pos = *last_pos;
+  }
+
+  si->scanned = pos;
+}
+
+/* Find the matching line closest to off, searching more of the file as
+ * needed.  Returns its offset, -1 if there is none or -2 if the search
+ * was interrupted. */
+static LOFF_T
+search_find (struct pager_file_t *pf, LOFF_T *last_pos, LOFF_T size,
+	     struct search_index_t *si, regex_t *SearchRE,
+	     PREFILTER *SearchPrefilter, LOFF_T off, int back, int incl)
+{
+  int lo, hi, mid;
+
+  FOREVER
+  {
+    /* find the first hit after off, or behind the last one before it */
+    lo = 0;
+    hi = si->count;
+    while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (si->hits[mid] < off ||
+	  (si->hits[mid] == off && (back ? incl : !incl)))
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+    if (!back && lo < si->count)
+      return si->hits[lo];
+    if (si->scanned >= size)
+    {
+      if (!back)
+	return -1;
+    }
+    else if (!back || si->scanned <= off)
+    {
+      if (SigInt)
+      {
+	SigInt = 0;
+	return -2;
+      }
+      search_scan (pf, last_pos, size, si, SearchRE, SearchPrefilter);
+      continue;
+    }
+
+    return (back && lo > 0) ? si->hits[lo - 1] : -1;
+  }
+}
+
+/* Returns the first line starting at or after off, laying out the message
+ * up to it if necessary, or -1 at the end of the message. */
+static int
+search_layout (struct pager_file_t *pf, LOFF_T *last_pos, LOFF_T off,
+	       struct line_t **lineInfo, int *last, int *max, int flags,
+	       struct q_list_t *QuoteList, int *q_level, int *force_redraw,
+	       regex_t *SearchRE, PREFILTER *SearchPrefilter)
+{
+  int lo, hi, mid;
+
+  if (*last > 0 && (*lineInfo)[*last - 1].offset >= off)
+  {
+    lo = 0;
+    hi = *last - 1;
+    while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if ((*lineInfo)[mid].offset < off)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+    return lo;
+  }
+
+  for (mid = MAX (*last - 1, 0); ; mid++)
+  {
+    if (display_line (pf, last_pos, lineInfo, mid, last, max, flags,
+		      QuoteList, q_level, force_redraw, SearchRE,
+		      SearchPrefilter) != 0)
+      return -1;
+    if ((*lineInfo)[mid].offset >= off)
+      return mid;
+  }
+}
+
+/* Find the line of the match closest to off which isn't hidden.  Returns
+ * -1 if there is none or -2 if the search was interrupted. */
+static int
+search_line (struct pager_file_t *pf, LOFF_T *last_pos, LOFF_T size,
+	     struct search_index_t *si, LOFF_T off, int back, int incl,
+	     struct line_t **lineInfo, int *last, int *max, int flags,
+	     struct q_list_t *QuoteList, int *q_level, int *force_redraw,
+	     regex_t *SearchRE, PREFILTER *SearchPrefilter, int hiding)
+{
+  int i;
+
+  FOREVER
+  {
+    if ((off = search_find (pf, last_pos, size, si, SearchRE, SearchPrefilter,
+			    off, back, incl)) < 0)
+      return (int) off;
+    if ((i = search_layout (pf, last_pos, off, lineInfo, last, max, flags,
+			    QuoteList, q_level, force_redraw, SearchRE,
+			    SearchPrefilter)) < 0)
+      return -1;
+    if (!hiding || (*lineInfo)[i].type != MT_COLOR_QUOTED)
+      return i;
+    incl = 0;
+  }
+}
+
 static struct mapping_t PagerHelp[] = {
   { N_("Exit"),	OP_EXIT },
   { N_("PrevPg"), OP_PREV_PAGE },
@@ -1529,19 +1651,23 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
   char buffer[LONG_STRING];
   char helpstr[SHORT_STRING*2];
   char tmphelp[SHORT_STRING*2];
-  int maxLine, lastLine = 0;
+  int maxLine, lastLine = 0, layout_done = 0;
   struct line_t *lineInfo;
-  struct q_class_t *QuoteList = NULL;
+  struct q_list_t QuoteList;
   int i, j, ch = 0, rc = -1, hideQuoted = 0, q_level = 0, force_redraw = 0;
   int lines = 0, curline = 0, topline = 0, oldtopline = 0, err, first = 1;
   int r = -1, wrapped = 0, searchctx = 0;
   int redraw = REDRAW_FULL;
   FILE *fp = NULL;
+  struct pager_file_t pf;
   LOFF_T last_pos = 0, last_offset = 0;
   int old_smart_wrap, old_markers;
   struct stat sb;
   regex_t SearchRE;
-  int SearchCompiled = 0, SearchFlag = 0, SearchBack = 0;
+  PREFILTER *SearchPrefilter = NULL;
+  int SearchCompiled = 0, SearchFlag = 0, SearchBack = 0, back;
+  struct search_index_t searchidx;
+  LOFF_T search_off;
   int has_types = (IsHeader(extra) || (flags & M_SHOWCOLOR)) ? M_TYPES : 0; /* main message or rfc822 attachment */
 
   int bodyoffset = 1;			/* offset of first line of real text */
@@ -1573,6 +1699,23 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
   }
   unlink (fname);
 
+  pf.fp = fp;
+  pf.map = NULL;
+  pf.len = 0;
+  memset (&searchidx, 0, sizeof (searchidx));
+  memset (&QuoteList, 0, sizeof (QuoteList));
+  search_reset (&searchidx);
+#ifdef HAVE_MMAP
+  /* lines are found with memchr() on the mapped file, which is much
+   * faster than reading them through stdio */
+  if (sb.st_size > 0 &&
+      (pf.map = mmap (NULL, sb.st_size, PROT_READ, MAP_PRIVATE,
+		      fileno (fp), 0)) == MAP_FAILED)
+    pf.map = NULL;
+  if (pf.map)
+    pf.len = sb.st_size;
+#endif
+
   /* Initialize variables */
 
   if (IsHeader (extra) && !extra->hdr->read)
@@ -1615,6 +1758,7 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
       /* clear() doesn't optimize screen redraws */
       move (0, 0);
       clrtobot ();
+      menu_forget_rows ();
 
       if (IsHeader (extra) && Context->vcount + 1 < PagerIndexLines)
 	indexlen = Context->vcount + 1;
@@ -1659,6 +1803,7 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
 	{
 	  REGCOMP
 	    (&SearchRE, searchbuf, REG_NEWLINE | mutt_which_case (searchbuf));
+	  SearchPrefilter = mutt_prefilter_new (searchbuf, mutt_which_case (searchbuf));
 	  SearchFlag = M_SEARCH;
 	  SearchBack = Resize->SearchBack;
 	}
@@ -1706,9 +1851,9 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
     {
       i = -1;
       j = -1;
-      while (display_line (fp, &last_pos, &lineInfo, ++i, &lastLine, &maxLine,
+      while (display_line (&pf, &last_pos, &lineInfo, ++i, &lastLine, &maxLine,
 	     has_types | SearchFlag | (flags & M_PAGER_NOWRAP), &QuoteList, &q_level, &force_redraw,
-	     &SearchRE) == 0)
+	     &SearchRE, SearchPrefilter) == 0)
 	if (!lineInfo[i].continuation && ++j == lines)
 	{
 	  topline = i;
@@ -1727,10 +1872,10 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
 
 	while (lines < bodylen && lineInfo[curline].offset <= sb.st_size - 1)
 	{
-	  if (display_line (fp, &last_pos, &lineInfo, curline, &lastLine, 
+	  if (display_line (&pf, &last_pos, &lineInfo, curline, &lastLine, 
 			    &maxLine,
 			    (flags & M_DISPLAYFLAGS) | hideQuoted | SearchFlag | (flags & M_PAGER_NOWRAP),
-			    &QuoteList, &q_level, &force_redraw, &SearchRE) > 0)
+			    &QuoteList, &q_level, &force_redraw, &SearchRE, SearchPrefilter) > 0)
 	    lines++;
 	  curline++;
 	}
@@ -1827,6 +1972,31 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
     }
     else
       OldHdr = NULL;
+
+    /* finish the search while the user is reading */
+    while (SearchCompiled && searchidx.scanned < sb.st_size &&
+	   !mutt_input_pending ())
+      search_scan (&pf, &last_pos, sb.st_size, &searchidx, &SearchRE,
+		   SearchPrefilter);
+
+    /* lay out the rest of the message while the user is reading */
+    if (option (OPTPAGERBGLAYOUT) && !layout_done)
+    {
+      while (!layout_done && !mutt_input_pending ())
+      {
+	for (i = MAX (lastLine - 1, 0), j = 0; j < PAGER_LAYOUT_CHUNK; i++, j++)
+	{
+	  if (display_line (&pf, &last_pos, &lineInfo, i, &lastLine,
+			    &maxLine, has_types | (flags & M_PAGER_NOWRAP),
+			    &QuoteList, &q_level, &force_redraw,
+			    &SearchRE, SearchPrefilter) != 0)
+	  {
+	    layout_done = 1;
+	    break;
+	  }
+	}
+      }
+    }
       
     ch = km_dokey (MENU_PAGER);
     if (ch != -1)
@@ -1879,6 +2049,7 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
 
 	lastLine = 0;
 	topline = 0;
+	layout_done = 0;
 
 	redraw = REDRAW_FULL | REDRAW_SIGWINCH;
 	ch = 0;
@@ -1999,56 +2170,51 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
 search_next:
 	  if ((!SearchBack && ch==OP_SEARCH_NEXT) ||
 	      (SearchBack &&ch==OP_SEARCH_OPPOSITE))
-	  {
-	    /* searching forward */
-	    for (i = wrapped ? 0 : topline + searchctx + 1; i < lastLine; i++)
-	    {
-	      if ((!hideQuoted || lineInfo[i].type != MT_COLOR_QUOTED) && 
-		    !lineInfo[i].continuation && lineInfo[i].search_cnt > 0)
-		break;
-	    }
+	    back = 0;
+	  else
+	    back = 1;
 
-	    if (i < lastLine)
-	      topline = i;
-	    else if (wrapped || !option (OPTWRAPSEARCH))
-	      mutt_error _("Not found.");
-	    else
-	    {
-	      mutt_message _("Search wrapped to top.");
-	      wrapped = 1;
-	      goto search_next;
-	    }
-	  }
+	  if (wrapped)
+	    search_off = back ? sb.st_size : 0;
 	  else
 	  {
-	    /* searching backward */
-	    for (i = wrapped ? lastLine : topline + searchctx - 1; i >= 0; i--)
-	    {
-	      if ((!hideQuoted || (has_types && 
-		    lineInfo[i].type != MT_COLOR_QUOTED)) && 
-		    !lineInfo[i].continuation && lineInfo[i].search_cnt > 0)
+	    /* the search starts behind the line the last match was shown on */
+	    j = topline + searchctx;
+	    for (i = MAX (lastLine - 1, 0); i <= j; i++)
+	      if (display_line (&pf, &last_pos, &lineInfo, i, &lastLine,
+				&maxLine, has_types | (flags & M_PAGER_NOWRAP),
+				&QuoteList, &q_level, &force_redraw,
+				&SearchRE, SearchPrefilter) != 0)
 		break;
-	    }
-
-	    if (i >= 0)
-	      topline = i;
-	    else if (wrapped || !option (OPTWRAPSEARCH))
-	      mutt_error _("Not found.");
-	    else
-	    {
-	      mutt_message _("Search wrapped to bottom.");
-	      wrapped = 1;
-	      goto search_next;
-	    }
+	    search_off = j < lastLine ? lineInfo[j].offset : sb.st_size;
 	  }
 
-	  if (lineInfo[topline].search_cnt > 0)
+	  i = search_line (&pf, &last_pos, sb.st_size, &searchidx, search_off,
+			   back, wrapped, &lineInfo, &lastLine, &maxLine,
+			   has_types | (flags & M_PAGER_NOWRAP), &QuoteList,
+			   &q_level, &force_redraw, &SearchRE, SearchPrefilter,
+			   hideQuoted);
+	  if (i == -2)
+	    mutt_error _("Search interrupted.");
+	  else if (i >= 0)
 	  {
+	    topline = i;
 	    SearchFlag = M_SEARCH;
 	    /* give some context for search results */
 	    if (topline - searchctx > 0)
 	      topline -= searchctx;
 	  }
+	  else if (wrapped || !option (OPTWRAPSEARCH))
+	    mutt_error _("Not found.");
+	  else
+	  {
+	    if (back)
+	      mutt_message _("Search wrapped to bottom.");
+	    else
+	      mutt_message _("Search wrapped to top.");
+	    wrapped = 1;
+	    goto search_next;
+	  }
 
 	  break;
 	}
@@ -2092,6 +2258,7 @@ search_next:
 	if (SearchCompiled)
 	{
 	  regfree (&SearchRE);
+	  mutt_prefilter_free (&SearchPrefilter);
 	  for (i = 0; i < lastLine; i++)
 	  {
 	    if (lineInfo[i].search)
@@ -2118,46 +2285,27 @@ search_next:
 	else
 	{
 	  SearchCompiled = 1;
-	  /* update the search pointers */
-	  i = 0;
-	  while (display_line (fp, &last_pos, &lineInfo, i, &lastLine, 
-				&maxLine, M_SEARCH | (flags & M_PAGER_NSKIP) | (flags & M_PAGER_NOWRAP),
-				&QuoteList, &q_level,
-				&force_redraw, &SearchRE) == 0)
-	    i++;
-
-	  if (!SearchBack)
-	  {
-	    /* searching forward */
-	    for (i = topline; i < lastLine; i++)
-	    {
-	      if ((!hideQuoted || lineInfo[i].type != MT_COLOR_QUOTED) && 
-		    !lineInfo[i].continuation && lineInfo[i].search_cnt > 0)
-		break;
-	    }
-
-	    if (i < lastLine) topline = i;
-	  }
-	  else
-	  {
-	    /* searching backward */
-	    for (i = topline; i >= 0; i--)
-	    {
-	      if ((!hideQuoted || lineInfo[i].type != MT_COLOR_QUOTED) && 
-		    !lineInfo[i].continuation && lineInfo[i].search_cnt > 0)
-		break;
-	    }
-
-	    if (i >= 0) topline = i;
-	  }
-
-	  if (lineInfo[topline].search_cnt == 0)
+	  SearchPrefilter = mutt_prefilter_new (searchbuf, mutt_which_case (searchbuf));
+	  search_reset (&searchidx);
+
+	  /* show the first match as soon as it has been found, the rest of
+	   * the message is searched while the pager is idle */
+	  i = search_line (&pf, &last_pos, sb.st_size, &searchidx,
+			   lineInfo[topline].offset, SearchBack, 1, &lineInfo,
+			   &lastLine, &maxLine, has_types | (flags & M_PAGER_NOWRAP),
+			   &QuoteList, &q_level, &force_redraw, &SearchRE,
+			   SearchPrefilter, hideQuoted);
+	  if (i < 0)
 	  {
 	    SearchFlag = 0;
-	    mutt_error _("Not found.");
+	    if (i == -2)
+	      mutt_error _("Search interrupted.");
+	    else
+	      mutt_error _("Not found.");
 	  }
 	  else
 	  {
+	    topline = i;
 	    SearchFlag = M_SEARCH;
 	    /* give some context for search results */
 	    if (SearchContext > 0 && SearchContext < LINES - 2 - option (OPTHELP) ? 1 : 0)
@@ -2211,9 +2359,9 @@ search_next:
 	  int new_topline = topline;
 
 	  while ((new_topline < lastLine ||
-		  (0 == (dretval = display_line (fp, &last_pos, &lineInfo,
+		  (0 == (dretval = display_line (&pf, &last_pos, &lineInfo,
 			 new_topline, &lastLine, &maxLine, M_TYPES | (flags & M_PAGER_NOWRAP),
-			 &QuoteList, &q_level, &force_redraw, &SearchRE))))
+			 &QuoteList, &q_level, &force_redraw, &SearchRE, SearchPrefilter))))
 		 && lineInfo[new_topline].type != MT_COLOR_QUOTED)
 	    new_topline++;
 
@@ -2224,9 +2372,9 @@ search_next:
 	  }
 
 	  while ((new_topline < lastLine ||
-		  (0 == (dretval = display_line (fp, &last_pos, &lineInfo,
+		  (0 == (dretval = display_line (&pf, &last_pos, &lineInfo,
 			 new_topline, &lastLine, &maxLine, M_TYPES | (flags & M_PAGER_NOWRAP),
-			 &QuoteList, &q_level, &force_redraw, &SearchRE))))
+			 &QuoteList, &q_level, &force_redraw, &SearchRE, SearchPrefilter))))
 		 && lineInfo[new_topline].type == MT_COLOR_QUOTED)
 	    new_topline++;
 
@@ -2244,10 +2392,10 @@ search_next:
 	{
 	  i = curline;
 	  /* make sure the types are defined to the end of file */
-	  while (display_line (fp, &last_pos, &lineInfo, i, &lastLine, 
+	  while (display_line (&pf, &last_pos, &lineInfo, i, &lastLine, 
 				&maxLine, has_types | (flags & M_PAGER_NOWRAP),
 				&QuoteList, &q_level, &force_redraw,
-				&SearchRE) == 0)
+				&SearchRE, SearchPrefilter) == 0)
 	    i++;
 	  topline = upNLines (bodylen, lineInfo, lastLine, hideQuoted);
 	}
@@ -2435,6 +2583,7 @@ search_next:
 	  if (SearchCompiled)
 	  {
 	    regfree (&SearchRE);
+	    mutt_prefilter_free (&SearchPrefilter);
 	    SearchCompiled = 0;
 	  }
 	  SearchFlag = 0;
@@ -2442,11 +2591,12 @@ search_next:
 	  /* try to keep the old position */
 	  topline = 0;
 	  lastLine = 0;
-	  while (j > 0 && display_line (fp, &last_pos, &lineInfo, topline, 
+	  layout_done = 0;
+	  while (j > 0 && display_line (&pf, &last_pos, &lineInfo, topline, 
 					&lastLine, &maxLine,
 					(has_types ? M_TYPES : 0) | (flags & M_PAGER_NOWRAP),
 					&QuoteList, &q_level, &force_redraw,
-					&SearchRE) == 0)
+					&SearchRE, SearchPrefilter) == 0)
 	  {
 	    if (! lineInfo[topline].continuation)
 	      j--;
@@ -2738,6 +2888,11 @@ search_next:
     }
   }
 
+  search_reset (&searchidx);
+#ifdef HAVE_MMAP
+  if (pf.map)
+    munmap (pf.map, pf.len);
+#endif
   safe_fclose (&fp);
   if (IsHeader (extra))
   {
@@ -2762,6 +2917,7 @@ search_next:
   if (SearchCompiled)
   {
     regfree (&SearchRE);
+    mutt_prefilter_free (&SearchPrefilter);
     SearchCompiled = 0;
   }
   FREE (&lineInfo);
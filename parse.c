@@ -940,9 +940,88 @@ char *mutt_extract_message_id (const char *s, const char **saveptr)
   return NULL;
 }
 
+/* The MIME summary is a compact record of a message's part tree, kept
+ * with the header (and in the header cache) so that attachments can be
+ * counted without reading the message again.  Each part is written as
+ * its type and disposition, one letter each, followed by its subtype
+ * and, in parentheses, its own parts; siblings are separated by commas:
+ *
+ *   "haplain,cbpdf"		text/plain inline, application/pdf attachment
+ *
+ * Only what count_body_parts() looks at is recorded. */
+
+static void mime_summary_add (BUFFER *buf, BODY *b)
+{
+  const char *s;
+
+  for (; b; b = b->next)
+  {
+    mutt_buffer_addch (buf, 'a' + b->type);
+    mutt_buffer_addch (buf, 'a' + b->disposition);
+    for (s = NONULL (b->subtype); *s; s++)
+      mutt_buffer_addch (buf, (*s == '(' || *s == ')' || *s == ',' ||
+			       (unsigned char) *s <= ' ') ? '?' : *s);
+    if (b->parts)
+    {
+      mutt_buffer_addch (buf, '(');
+      mime_summary_add (buf, b->parts);
+      mutt_buffer_addch (buf, ')');
+    }
+    if (b->next)
+      mutt_buffer_addch (buf, ',');
+  }
+}
+
+static char *mime_summary (BODY *parts)
+{
+  BUFFER buf;
+
+  memset (&buf, 0, sizeof (buf));
+  mime_summary_add (&buf, parts);
+
+  return buf.data ? buf.data : safe_calloc (1, 1);
+}
+
+/* rebuild a skeleton part tree from a summary; only the fields recorded
+ * by mime_summary_add() are filled in. */
+static BODY *mime_summary_parts (const char **s)
+{
+  BODY *parts = NULL, **last = &parts, *b;
+  const char *p;
+
+  while (**s && **s != ')')
+  {
+    if (!(*s)[1])
+      break;
+
+    b = *last = mutt_new_body ();
+    last = &b->next;
+
+    b->type = (*s)[0] - 'a';
+    b->disposition = (*s)[1] - 'a';
+    for (p = *s += 2; *p && *p != '(' && *p != ')' && *p != ','; p++)
+      ;
+    b->subtype = mutt_substrdup (*s, p);
+    *s = p;
+
+    if (**s == '(')
+    {
+      (*s)++;
+      b->parts = mime_summary_parts (s);
+      if (**s == ')')
+	(*s)++;
+    }
+    if (**s == ',')
+      (*s)++;
+  }
+
+  return parts;
+}
+
 void mutt_parse_mime_message (CONTEXT *ctx, HEADER *cur)
 {
   MESSAGE *msg;
+  char *summary;
 
   do {
     if (cur->content->type != TYPEMESSAGE &&
@@ -960,6 +1039,16 @@ void mutt_parse_mime_message (CONTEXT *ctx, HEADER *cur)
         cur->security = crypt_query (cur->content);
 
       mx_close_message (&msg);
+
+      summary = mime_summary (cur->content->parts);
+      if (mutt_strcmp (summary, cur->mime_summary))
+      {
+	FREE (&cur->mime_summary);
+	cur->mime_summary = summary;
+	cur->summary_changed = 1;
+      }
+      else
+	FREE (&summary);
     }
   } while (0);
 
@@ -1434,6 +1523,9 @@ ENVELOPE *mutt_read_rfc822_header (FILE *f, HEADER *hdr, short user_hdrs,
     rfc2047_decode_adrlist (e->sender);
     rfc2047_decode (&e->x_label);
 
+    if (option (OPTINTERNSTRINGS))
+      mutt_intern_envelope (e);
+
     if (e->subject)
     {
       regmatch_t pmatch[1];
@@ -1621,6 +1713,16 @@ int mutt_count_body_parts (CONTEXT *ctx, HEADER *hdr)
   
   if (hdr->content->parts)
     keep_parts = 1;
+  else if (hdr->mime_summary &&
+	   (hdr->content->type == TYPEMULTIPART ||
+	    hdr->content->type == TYPEMESSAGE))
+  {
+    /* counting only needs the shape of the part tree, which the summary
+     * has; don't read the message. */
+    const char *s = hdr->mime_summary;
+
+    hdr->content->parts = mime_summary_parts (&s);
+  }
   else
     mutt_parse_mime_message (ctx, hdr);
   
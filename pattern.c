@@ -42,6 +42,10 @@
 #include "imap/imap.h"
 #endif
 
+#ifdef USE_HCACHE
+#include "hcache.h"
+#endif
+
 static int eat_regexp (pattern_t *pat, BUFFER *, BUFFER *);
 static int eat_date (pattern_t *pat, BUFFER *, BUFFER *);
 static int eat_range (pattern_t *pat, BUFFER *, BUFFER *);
@@ -144,10 +148,9 @@ int mutt_which_case (const char *s)
 static int
 msg_search (CONTEXT *ctx, pattern_t* pat, int msgno)
 {
-  char tempfile[_POSIX_PATH_MAX];
   MESSAGE *msg = NULL;
   STATE s;
-  struct stat st;
+  STATE_SINK sink;
   FILE *fp = NULL;
   long lng = 0;
   int match = 0;
@@ -163,12 +166,10 @@ msg_search (CONTEXT *ctx, pattern_t* pat, int msgno)
       memset (&s, 0, sizeof (s));
       s.fpin = msg->fp;
       s.flags = M_CHARCONV;
-      mutt_mktemp (tempfile, sizeof (tempfile));
-      if ((s.fpout = safe_fopen (tempfile, "w+")) == NULL)
-      {
-	mutt_perror (tempfile);
+      if (state_sink_open (&sink, h->content->offset - h->offset +
+			   h->content->length) == -1)
 	return (0);
-      }
+      s.fpout = sink.fp;
 
       if (pat->op != M_BODY)
 	mutt_copy_header (msg->fp, h, s.fpout, CH_FROM | CH_DECODE, NULL);
@@ -181,11 +182,7 @@ msg_search (CONTEXT *ctx, pattern_t* pat, int msgno)
             && !crypt_valid_passphrase(h->security))
 	{
 	  mx_close_message (&msg);
-	  if (s.fpout)
-	  {
-	    safe_fclose (&s.fpout);
-	    unlink (tempfile);
-	  }
+	  state_sink_close (&sink);
 	  return (0);
 	}
 
@@ -193,11 +190,8 @@ msg_search (CONTEXT *ctx, pattern_t* pat, int msgno)
 	mutt_body_handler (h->content, &s);
       }
 
-      fp = s.fpout;
-      fflush (fp);
-      fseek (fp, 0, 0);
-      fstat (fileno (fp), &st);
-      lng = (long) st.st_size;
+      lng = (long) state_sink_rewind (&sink);
+      fp = sink.fp;
     }
     else
     {
@@ -242,10 +236,7 @@ msg_search (CONTEXT *ctx, pattern_t* pat, int msgno)
     mx_close_message (&msg);
 
     if (option (OPTTHOROUGHSRC))
-    {
-      safe_fclose (&fp);
-      unlink (tempfile);
-    }
+      state_sink_close (&sink);
   }
 
   return match;
@@ -290,14 +281,16 @@ static int eat_regexp (pattern_t *pat, BUFFER *s, BUFFER *err)
   {
     pat->p.rx = safe_malloc (sizeof (regex_t));
     r = REGCOMP (pat->p.rx, buf.data, REG_NEWLINE | REG_NOSUB | mutt_which_case (buf.data));
-    FREE (&buf.data);
     if (r)
     {
+      FREE (&buf.data);
       regerror (r, pat->p.rx, err->data, err->dsize);
       regfree (pat->p.rx);
       FREE (&pat->p.rx);
       return (-1);
     }
+    pat->prefilter = mutt_prefilter_new (buf.data, mutt_which_case (buf.data));
+    FREE (&buf.data);
   }
 
   return 0;
@@ -707,7 +700,7 @@ static int patmatch (const pattern_t* pat, const char* buf)
   else if (pat->groupmatch)
     return !mutt_group_match (pat->p.g, buf);
   else
-    return regexec (pat->p.rx, buf, 0, NULL, 0);
+    return mutt_prefilter_regexec (pat->p.rx, pat->prefilter, buf, 0, NULL, 0);
 }
 
 static struct pattern_flags *lookup_tag (char tag)
@@ -755,6 +748,7 @@ void mutt_pattern_free (pattern_t **pat)
     {
       regfree (tmp->p.rx);
       FREE (&tmp->p.rx);
+      mutt_prefilter_free (&tmp->prefilter);
     }
 
     if (tmp->child)
@@ -1202,7 +1196,20 @@ mutt_pattern_exec (struct pattern_t *pat, pattern_exec_flag flags, CONTEXT *ctx,
     case M_HORMEL:
       return (pat->not ^ (h->env->spam && h->env->spam->data && patmatch (pat, h->env->spam->data) == 0));
     case M_DUPLICATED:
-      return (pat->not ^ (h->thread && h->thread->duplicate_thread));
+      if (h->thread && h->thread->duplicate_thread)
+	return (!pat->not);
+#ifdef USE_HCACHE
+      /* a copy in another folder, as far as the Message-ID index knows */
+      if (ctx && h->env->message_id)
+      {
+	char folder[_POSIX_PATH_MAX];
+
+	if (mutt_hcache_msgid_lookup (h->env->message_id, ctx->path,
+				      folder, sizeof (folder)) == 0)
+	  return (!pat->not);
+      }
+#endif
+      return (pat->not);
     case M_MIMEATTACH:
       {
       int count = mutt_count_body_parts (ctx, h);
@@ -1283,13 +1290,125 @@ void mutt_check_simple (char *s, size_t len, const char *simple)
   }
 }
 
+/* Can the result of pat change while the mailbox is open?  Flags, scores,
+ * threads, message numbers, groups and relative dates all can.
+ */
+static int pattern_is_static (const pattern_t *pat)
+{
+  for (; pat; pat = pat->next)
+  {
+    if (pat->groupmatch)
+      return 0;
+    switch (pat->op)
+    {
+      case M_AND:
+      case M_OR:
+	if (!pattern_is_static (pat->child))
+	  return 0;
+	break;
+      case M_TO:
+      case M_CC:
+      case M_SUBJECT:
+      case M_FROM:
+      case M_ID:
+      case M_BODY:
+      case M_HEADER:
+      case M_HORMEL:
+      case M_WHOLE_MSG:
+      case M_SENDER:
+      case M_SIZE:
+      case M_REFERENCE:
+      case M_RECIPIENT:
+      case M_ADDRESS:
+      case M_XLABEL:
+	break;
+      default:
+	return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * How does the limit s, compiled to pat, relate to the current one?
+ * Returns 1 if s only adds terms to it, as in "~f joe" followed by
+ * "~f joe ~s lunch", and -1 if s only adds alternatives, as in "~f joe |
+ * ~f bob".  If the current limit is static, only the messages it let
+ * through can match s in the first case, and all of them do in the
+ * second.  Returns 0 otherwise.
+ */
+static int limit_relation (CONTEXT *ctx, const char *s, const pattern_t *pat)
+{
+  char buf[LONG_STRING];
+  const char *p;
+  size_t len;
+  char quote = 0;
+  int rel;
+
+  if (!ctx->pattern || !ctx->limit_pattern ||
+      !pattern_is_static (ctx->limit_pattern))
+    return 0;
+
+  len = mutt_strlen (ctx->pattern);
+  if (mutt_strncmp (s, ctx->pattern, len) != 0 || !ISSPACE (s[len]))
+    return 0;
+
+  /* "OLD X | Y" isn't narrower than OLD.  The pattern compiler groups
+   * from the left, so "OLD | X" is wider as long as X adds no terms:
+   * "OLD | X Y" is (OLD | X) & Y, whose top isn't an or. */
+  for (p = s + len; ISSPACE (*p); p++)
+    ;
+  if (*p == '|' && pat->op == M_OR && !pat->not && !pat->next)
+    rel = -1;
+  else if (!strchr (s, '|'))
+    rel = 1;
+  else
+    return 0;
+
+  /* the current limit must have been used verbatim ... */
+  strfcpy (buf, ctx->pattern, sizeof (buf));
+  mutt_check_simple (buf, sizeof (buf), NONULL (SimpleSearch));
+  if (mutt_strcmp (buf, ctx->pattern) != 0)
+    return 0;
+
+  /* ... and must not leave a quoted string open */
+  for (p = ctx->pattern; *p; p++)
+  {
+    if (*p == '\\')
+    {
+      if (!*++p)
+	return 0;
+    }
+    else if (quote && *p == quote)
+      quote = 0;
+    else if (!quote && (*p == '\'' || *p == '"'))
+      quote = *p;
+  }
+
+  return quote ? 0 : rel;
+}
+
+#ifdef USE_HCACHE
+/* whether op is used anywhere in pat */
+static int pattern_has_op (const pattern_t *pat, int op)
+{
+  for (; pat; pat = pat->next)
+    if (pat->op == op || pattern_has_op (pat->child, op))
+      return 1;
+  return 0;
+}
+#endif
+
 int mutt_pattern_func (int op, char *prompt)
 {
   pattern_t *pat;
   char buf[LONG_STRING] = "", *simple, error[STRING];
   BUFFER err;
-  int i;
+  int i, rel = 0;
   progress_t progress;
+#ifdef USE_HCACHE
+  int hold;
+#endif
 
   strfcpy (buf, NONULL (Context->pattern), sizeof (buf));
   if (mutt_get_field (prompt, buf, sizeof (buf), M_PATTERN | M_CLEAR) != 0 || !buf[0])
@@ -1320,21 +1439,40 @@ int mutt_pattern_func (int op, char *prompt)
 
 #define THIS_BODY Context->hdrs[i]->content
 
+#ifdef USE_HCACHE
+  /* ~= looks every message up in the Message-ID index */
+  if ((hold = pattern_has_op (pat, M_DUPLICATED)))
+    mutt_hcache_msgid_hold (1);
+#endif
+
   if (op == M_LIMIT)
   {
+    rel = limit_relation (Context, simple, pat);
+    mutt_invalidate_index_lines ();
+    mutt_invalidate_thread_counts (Context);
     Context->vcount    = 0;
     Context->vsize     = 0;
     Context->collapsed = 0;
 
     for (i = 0; i < Context->msgcount; i++)
     {
+      int limited = Context->hdrs[i]->limited, match;
+
       mutt_progress_update (&progress, i, -1);
       /* new limit pattern implicitly uncollapses all threads */
       Context->hdrs[i]->virtual = -1;
       Context->hdrs[i]->limited = 0;
       Context->hdrs[i]->collapsed = 0;
       Context->hdrs[i]->num_hidden = 0;
-      if (mutt_pattern_exec (pat, M_MATCH_FULL_ADDRESS, Context, Context->hdrs[i]))
+
+      if (rel < 0 && limited)
+	match = 1;
+      else if (rel > 0 && !limited)
+	match = 0;
+      else
+	match = mutt_pattern_exec (pat, M_MATCH_FULL_ADDRESS, Context,
+				   Context->hdrs[i]);
+      if (match)
       {
 	Context->hdrs[i]->virtual = Context->vcount;
 	Context->hdrs[i]->limited = 1;
@@ -1371,6 +1509,11 @@ int mutt_pattern_func (int op, char *prompt)
 
 #undef THIS_BODY
 
+#ifdef USE_HCACHE
+  if (hold)
+    mutt_hcache_msgid_hold (0);
+#endif
+
   mutt_clear_error ();
 
   if (op == M_LIMIT)
@@ -1403,10 +1546,13 @@ int mutt_search_command (int cur, int op)
   char temp[LONG_STRING];
   char error[STRING];
   BUFFER err;
-  int incr;
+  int incr, rc = -1;
   HEADER *h;
   progress_t progress;
   const char* msg = NULL;
+#ifdef USE_HCACHE
+  int hold;
+#endif
 
   if (!*LastSearch || (op != OP_SEARCH_NEXT && op != OP_SEARCH_OPPOSITE))
   {
@@ -1463,6 +1609,11 @@ int mutt_search_command (int cur, int op)
   mutt_progress_init (&progress, _("Searching..."), M_PROGRESS_MSG,
 		      ReadInc, Context->vcount);
 
+#ifdef USE_HCACHE
+  if ((hold = pattern_has_op (SearchPattern, M_DUPLICATED)))
+    mutt_hcache_msgid_hold (1);
+#endif
+
   for (i = cur + incr, j = 0 ; j != Context->vcount; j++)
   {
     mutt_progress_update (&progress, j, -1);
@@ -1474,7 +1625,7 @@ int mutt_search_command (int cur, int op)
       else 
       {
         mutt_message _("Search hit bottom without finding match");
-	return (-1);
+	goto out;
       }
     }
     else if (i < 0)
@@ -1485,7 +1636,7 @@ int mutt_search_command (int cur, int op)
       else 
       {
         mutt_message _("Search hit top without finding match");
-	return (-1);
+	goto out;
       }
     }
 
@@ -1498,7 +1649,8 @@ int mutt_search_command (int cur, int op)
 	mutt_clear_error();
 	if (msg && *msg)
 	  mutt_message (msg);
-	return i;
+	rc = i;
+	goto out;
       }
     }
     else
@@ -1510,7 +1662,8 @@ int mutt_search_command (int cur, int op)
 	mutt_clear_error();
 	if (msg && *msg)
 	  mutt_message (msg);
-	return i;
+	rc = i;
+	goto out;
       }
     }
 
@@ -1518,12 +1671,18 @@ int mutt_search_command (int cur, int op)
     {
       mutt_error _("Search interrupted.");
       SigInt = 0;
-      return (-1);
+      goto out;
     }
 
     i += incr;
   }
 
   mutt_error _("Not found.");
-  return (-1);
+
+out:
+#ifdef USE_HCACHE
+  if (hold)
+    mutt_hcache_msgid_hold (0);
+#endif
+  return rc;
 }
@@ -478,6 +478,34 @@ static void pop_clear_cache (POP_DATA *pop_data)
 }
 
 /* close POP mailbox */
+#if USE_HCACHE
+/* store the MIME summaries worked out during this session, so that
+ * attachment counts don't need the messages fetched next time */
+static void pop_store_summaries (CONTEXT *ctx)
+{
+  header_cache_t *hc = NULL;
+  HEADER *h;
+  int i;
+
+  for (i = 0; i < ctx->msgcount; i++)
+  {
+    h = ctx->hdrs[i];
+    /* the sync may just have removed deleted ones from the cache */
+    if (!h || !h->data || !h->summary_changed || h->deleted)
+      continue;
+
+    if (!hc && !(hc = pop_hcache_open (ctx->data, ctx->path)))
+      return;
+
+    mutt_hcache_store (hc, h->data, h, 0, strlen);
+    h->summary_changed = 0;
+  }
+
+  if (hc)
+    mutt_hcache_close (hc);
+}
+#endif
+
 int pop_close_mailbox (CONTEXT *ctx)
 {
   POP_DATA *pop_data = (POP_DATA *)ctx->data;
@@ -485,6 +513,10 @@ int pop_close_mailbox (CONTEXT *ctx)
   if (!pop_data)
     return 0;
 
+#if USE_HCACHE
+  pop_store_summaries (ctx);
+#endif
+
   pop_logout (ctx);
 
   if (pop_data->status != POP_NONE)
@@ -515,6 +547,7 @@ int pop_fetch_message (MESSAGE* msg, CONTEXT* ctx, int msgno)
   POP_CACHE *cache;
   HEADER *h = ctx->hdrs[msgno];
   unsigned short bcache = 1;
+  int read, old;
 
   /* see if we already have the message in body cache */
   if ((msg->fp = mutt_bcache_get (pop_data->bcache, h->data)))
@@ -618,9 +651,13 @@ int pop_fetch_message (MESSAGE* msg, CONTEXT* ctx, int msgno)
   }
   rewind (msg->fp);
   uidl = h->data;
+  read = h->read;
+  old = h->old;
   mutt_free_envelope (&h->env);
   h->env = mutt_read_rfc822_header (msg->fp, h, 0, 0);
   h->data = uidl;
+  /* the Status header may have changed h->read and h->old */
+  mutt_thread_update_counts (ctx, h, read, old);
   h->lines = 0;
   fgets (buf, sizeof (buf), msg->fp);
   while (!feof (msg->fp))
@@ -635,6 +672,8 @@ int pop_fetch_message (MESSAGE* msg, CONTEXT* ctx, int msgno)
   if (!WithCrypto)
     h->security = crypt_query (h->content);
 
+  mutt_header_changed (h);
+
   mutt_clear_error();
   rewind (msg->fp);
 
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2026 The Mutt Project
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program; if not, write to the Free Software
+ *     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Literal prefilters for regular expressions.
+ *
+ * Most search expressions contain a literal substring which every match
+ * has to include.  We pull the longest such string out of the expression
+ * at compile time and look for it with Boyer-Moore-Horspool before
+ * handing a buffer to regexec(), which lets us skip the vast majority of
+ * lines during body and pager searches.
+ *
+ * The extraction is deliberately conservative: anything we don't fully
+ * understand simply ends the current literal run.  A prefilter must never
+ * reject a string the expression would have matched.
+ */
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "mutt.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+/* skip a bracket expression, s points just behind the opening '[' */
+static const char *skip_bracket (const char *s)
+{
+  if (*s == '^')
+    s++;
+  if (*s == ']')
+    s++;
+  for (; *s && *s != ']'; s++)
+  {
+    /* [:alpha:], [=a=] and [.-.] may contain a ']' of their own */
+    if (*s == '[' && (s[1] == ':' || s[1] == '=' || s[1] == '.'))
+    {
+      char term = s[1];
+
+      for (s += 2; *s && !(*s == term && s[1] == ']'); s++)
+	;
+      if (!*s)
+	return s;
+      s++;
+    }
+  }
+  return *s ? s + 1 : s;
+}
+
+/* skip a parenthesized group, s points just behind the opening '(' */
+static const char *skip_group (const char *s)
+{
+  int level = 1;
+
+  while (*s)
+  {
+    if (*s == '\\')
+    {
+      if (*++s)
+	s++;
+    }
+    else if (*s == '[')
+      s = skip_bracket (s + 1);
+    else if (*s == '(')
+    {
+      level++;
+      s++;
+    }
+    else if (*s == ')')
+    {
+      s++;
+      if (--level == 0)
+	break;
+    }
+    else
+      s++;
+  }
+  return s;
+}
+
+/* Can c be part of a literal run?  With REG_ICASE, some ASCII letters
+ * fold to characters outside of ASCII in some locales (e.g. 's' and
+ * U+017F LATIN SMALL LETTER LONG S, or the Turkish dotted capital I),
+ * so we must not require them.
+ */
+static int literal_char (int c, int icase)
+{
+  if (c & 0x80)
+    return 0;
+  if (icase)
+  {
+    c = ascii_tolower (c);
+    if (c == 'i' || c == 'k' || c == 's')
+      return 0;
+  }
+  return 1;
+}
+
+/*
+ * Extract the longest literal every match of the extended regular
+ * expression rx has to contain.  Returns the length of the literal, which
+ * is copied to buf.
+ */
+static size_t extract_literal (const char *rx, int icase, char *buf, size_t buflen)
+{
+  char *cur;
+  size_t curlen = 0, bestlen = 0;
+  const char *s = rx;
+  int c, optional;
+
+  cur = safe_malloc (buflen);
+
+#define END_RUN \
+  do { \
+    if (curlen > bestlen) \
+    { \
+      memcpy (buf, cur, curlen); \
+      bestlen = curlen; \
+    } \
+    curlen = 0; \
+  } while (0)
+
+  while (*s)
+  {
+    switch ((c = (unsigned char) *s++))
+    {
+      case '|':
+	/* top-level alternation, nothing is required */
+	FREE (&cur);
+	return 0;
+
+      case '(':
+	END_RUN;
+	s = skip_group (s);
+	break;
+
+      case '[':
+	END_RUN;
+	s = skip_bracket (s);
+	break;
+
+      case '*':
+      case '?':
+      case '{':
+      case '+':
+	/* the previous atom is optional unless it is only followed by '+'
+	 * quantifiers, as in "a+" */
+	for (optional = 0; ; c = (unsigned char) *s++)
+	{
+	  if (c != '+')
+	    optional = 1;
+	  if (c == '{')
+	  {
+	    while (*s && *s != '}')
+	      s++;
+	    if (*s)
+	      s++;
+	  }
+	  if (!*s || !strchr ("*?{+", *s))
+	    break;
+	}
+	if (optional && curlen)
+	  curlen--;
+	END_RUN;
+	break;
+
+      case '\\':
+	if (!*s)
+	{
+	  END_RUN;
+	  break;
+	}
+	c = (unsigned char) *s++;
+	/* \w, \b, \<, back references and friends */
+	if (isalnum (c) || strchr ("<>`'", c) || !literal_char (c, icase))
+	{
+	  END_RUN;
+	  break;
+	}
+	if (curlen + 1 < buflen)
+	  cur[curlen++] = icase ? ascii_tolower (c) : c;
+	break;
+
+      case '.':
+      case '^':
+      case '$':
+      case ')':
+	END_RUN;
+	break;
+
+      default:
+	if (!literal_char (c, icase))
+	{
+	  END_RUN;
+	  break;
+	}
+	if (curlen + 1 < buflen)
+	  cur[curlen++] = icase ? ascii_tolower (c) : c;
+	break;
+    }
+  }
+  END_RUN;
+
+#undef END_RUN
+
+  FREE (&cur);
+  buf[bestlen] = 0;
+  return bestlen;
+}
+
+/*
+ * Build a prefilter for the extended regular expression rx, compiled with
+ * cflags.  Returns NULL if rx has no required literal.
+ */
+PREFILTER *mutt_prefilter_new (const char *rx, int cflags)
+{
+  PREFILTER *pf;
+  char buf[STRING];
+  size_t len, i;
+  int icase = (cflags & REG_ICASE) ? 1 : 0;
+
+  if (!rx || !(len = extract_literal (rx, icase, buf, sizeof (buf))))
+    return NULL;
+
+  pf = safe_calloc (1, sizeof (PREFILTER));
+  pf->lit = (unsigned char *) safe_strdup (buf);
+  pf->len = len;
+  pf->icase = icase;
+
+  for (i = 0; i < 256; i++)
+  {
+    pf->fold[i] = icase ? ascii_tolower (i) : i;
+    pf->shift[i] = len;
+  }
+  for (i = 0; i + 1 < len; i++)
+  {
+    pf->shift[pf->lit[i]] = len - 1 - i;
+    if (icase)
+      pf->shift[ascii_toupper (pf->lit[i])] = len - 1 - i;
+  }
+
+  return pf;
+}
+
+void mutt_prefilter_free (PREFILTER **pf)
+{
+  if (!pf || !*pf)
+    return;
+  FREE (&(*pf)->lit);
+  FREE (pf);		/* __FREE_CHECKED__ */
+}
+
+/* Find the first occurrence of the literal in s (of length len).  Returns
+ * NULL if there is none.  A NULL prefilter matches at the start of s. */
+const char *mutt_prefilter_find (const PREFILTER *pf, const char *s, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) s;
+  size_t i, j, last;
+
+  if (!pf)
+    return s;
+  if (pf->len > len)
+    return NULL;
+
+  if (pf->len == 1 && !pf->icase)
+    return memchr (s, pf->lit[0], len);
+
+  last = pf->len - 1;
+  for (i = 0; i + last < len; i += pf->shift[p[i + last]])
+  {
+    for (j = last; pf->fold[p[i + j]] == pf->lit[j]; j--)
+      if (j == 0)
+	return s + i;
+  }
+
+  return NULL;
+}
+
+/* Does s (of length len) contain the literal?  A NULL prefilter accepts
+ * everything. */
+int mutt_prefilter_match (const PREFILTER *pf, const char *s, size_t len)
+{
+  return mutt_prefilter_find (pf, s, len) != NULL;
+}
+
+/* Drop-in replacement for regexec() which consults the prefilter first. */
+int mutt_prefilter_regexec (const regex_t *rx, const PREFILTER *pf,
+			    const char *s, size_t nmatch, regmatch_t pmatch[],
+			    int eflags)
+{
+  if (pf && !mutt_prefilter_match (pf, s, mutt_strlen (s)))
+    return REG_NOMATCH;
+  return regexec (rx, s, nmatch, pmatch, eflags);
+}
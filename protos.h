@@ -60,9 +60,11 @@ int _mutt_aside_thread (HEADER *, short, short);
 #define mutt_collapse_thread(x,y) _mutt_traverse_thread (x,y,M_THREAD_COLLAPSE)
 #define mutt_uncollapse_thread(x,y) _mutt_traverse_thread (x,y,M_THREAD_UNCOLLAPSE)
 #define mutt_get_hidden(x,y)_mutt_traverse_thread (x,y,M_THREAD_GET_HIDDEN) 
-#define mutt_thread_contains_unread(x,y) _mutt_traverse_thread (x,y,M_THREAD_UNREAD)
 #define mutt_thread_next_unread(x,y) _mutt_traverse_thread(x,y,M_THREAD_NEXT_UNREAD)
 int _mutt_traverse_thread (CONTEXT *ctx, HEADER *hdr, int flag);
+int mutt_thread_contains_unread (CONTEXT *ctx, HEADER *hdr);
+void mutt_invalidate_thread_counts (CONTEXT *ctx);
+void mutt_thread_update_counts (CONTEXT *ctx, HEADER *hdr, int read, int old);
 
 
 #define mutt_new_parameter() safe_calloc (1, sizeof (PARAMETER))
@@ -203,6 +205,9 @@ void mutt_free_body (BODY **);
 void mutt_free_color (int fg, int bg);
 void mutt_free_enter_state (ENTER_STATE **);
 void mutt_free_envelope (ENVELOPE **);
+void mutt_intern_envelope (ENVELOPE *);
+void mutt_str_intern (char **);
+void mutt_str_unintern (char **);
 void mutt_free_header (HEADER **);
 void mutt_free_parameter (PARAMETER **);
 void mutt_free_regexp (REGEXP **);
@@ -236,10 +241,12 @@ void mutt_query_menu (char *, size_t);
 void mutt_safe_path (char *s, size_t l, ADDRESS *a);
 void mutt_save_path (char *s, size_t l, ADDRESS *a);
 void mutt_score_message (CONTEXT *, HEADER *, int);
+void mutt_rescore_context (CONTEXT *);
 void mutt_select_fcc (char *, size_t, HEADER *);
 #define mutt_select_file(A,B,C) _mutt_select_file(A,B,C,NULL,NULL)
 void _mutt_select_file (char *, size_t, int, char ***, int *);
 void mutt_message_hook (CONTEXT *, HEADER *, int);
+void mutt_header_changed (HEADER *);
 void _mutt_set_flag (CONTEXT *, HEADER *, int, int, int);
 #define mutt_set_flag(a,b,c,d) _mutt_set_flag(a,b,c,d,1)
 void mutt_set_followup_to (ENVELOPE *);
@@ -256,6 +263,7 @@ void mutt_version (void);
 void mutt_view_attachments (HEADER *);
 void mutt_write_address_list (ADDRESS *adr, FILE *fp, int linelen, int display);
 void mutt_set_virtual (CONTEXT *);
+void mutt_set_virtual_thread (CONTEXT *, HEADER *);
 
 int mutt_add_to_rx_list (RX_LIST **list, const char *s, int flags, BUFFER *err);
 int mutt_addr_is_user (ADDRESS *);
@@ -356,6 +364,7 @@ int mutt_smtp_send (const ADDRESS *, const ADDRESS *, const ADDRESS *,
 int mutt_wstr_trunc (const char *, size_t, size_t, size_t *);
 int mutt_charlen (const char *s, int *);
 int mutt_strwidth (const char *);
+size_t mutt_ascii_run (const char *, size_t);
 int mutt_compose_menu (HEADER *, char *, size_t, HEADER *);
 int mutt_thread_set_flag (HEADER *, int, int, int);
 int mutt_user_is_recipient (HEADER *);
@@ -370,6 +379,8 @@ int mutt_write_rfc822_header (FILE *, ENVELOPE *, BODY *, int, int);
 void mutt_write_references (LIST *, FILE *, int);
 int mutt_yesorno (const char *, int);
 void mutt_set_header_color(CONTEXT *, HEADER *);
+void mutt_invalidate_index_colors (void);
+void mutt_invalidate_index_lines (void);
 void mutt_sleep (short);
 int mutt_save_confirm (const char  *, struct stat *);
 
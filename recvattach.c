@@ -1074,6 +1074,7 @@ void mutt_view_attachments (HEADER *hdr)
                                       menu->tagprefix))
         {
 	  hdr->security = crypt_query (cur);
+	  mutt_header_changed (hdr);
 	  menu->redraw = REDRAW_FULL;
 	}
         break;
@@ -1232,7 +1233,10 @@ void mutt_view_attachments (HEADER *hdr)
 	  if (!idx[idxmax])
 	    continue;
 	  if (idx[idxmax]->content && idx[idxmax]->content->deleted)
+	  {
 	    hdr->attach_del = 1;
+	    FREE (&hdr->mime_summary);
+	  }
 	  if (idx[idxmax]->content)
 	    idx[idxmax]->content->aptr = NULL;
 	  FREE (&idx[idxmax]->tree);
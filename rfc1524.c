@@ -167,15 +167,170 @@ static int get_field_text (char *field, char **entry,
   }
 }
 
+/* Mailcap files are read once and kept in memory, each entry filed
+ * under its major type, since the same handful of files gets searched
+ * for every attachment of every message displayed.  A file is read again
+ * when it changes on disk. */
+typedef struct mailcap_line
+{
+  char *type;				/* the content type field */
+  char *fields;				/* the rest of the entry */
+  int line;				/* line number, for error messages */
+  struct mailcap_line *next;		/* next entry in the file */
+  struct mailcap_line *next_major;	/* next entry with the same major type */
+} MAILCAP_LINE;
+
+typedef struct mailcap_major
+{
+  char *major;
+  MAILCAP_LINE *first;
+  MAILCAP_LINE *last;
+} MAILCAP_MAJOR;
+
+typedef struct mailcap_file
+{
+  char *path;
+  time_t mtime;
+  off_t size;
+  ino_t ino;
+  MAILCAP_LINE *lines;
+  HASH *majors;				/* major type -> MAILCAP_MAJOR */
+  struct mailcap_file *next;
+} MAILCAP_FILE;
+
+static MAILCAP_FILE *MailcapFiles = NULL;
+
+static void mailcap_free_major (void *p)
+{
+  MAILCAP_MAJOR *m = (MAILCAP_MAJOR *) p;
+
+  FREE (&m->major);
+  FREE (&m);
+}
+
+static void mailcap_free_lines (MAILCAP_FILE *mf)
+{
+  MAILCAP_LINE *l;
+
+  while ((l = mf->lines) != NULL)
+  {
+    mf->lines = l->next;
+    FREE (&l->type);
+    FREE (&l->fields);
+    FREE (&l);
+  }
+
+  if (mf->majors)
+    hash_destroy (&mf->majors, mailcap_free_major);
+}
+
+static int mailcap_load (MAILCAP_FILE *mf)
+{
+  FILE *fp;
+  char *buf = NULL;
+  size_t buflen;
+  char *ch, *major;
+  int line = 0;
+  MAILCAP_LINE *l, **last = &mf->lines;
+  MAILCAP_MAJOR *m;
+
+  if ((fp = fopen (mf->path, "r")) == NULL)
+    return -1;
+
+  mf->majors = hash_create (64, 1);
+
+  while ((buf = mutt_read_line (buf, &buflen, fp, &line, M_CONT)) != NULL)
+  {
+    /* ignore comments */
+    if (*buf == '#')
+      continue;
+
+    ch = get_field (buf);
+
+    l = safe_calloc (1, sizeof (MAILCAP_LINE));
+    l->type = mutt_substrdup (buf, NULL);
+    l->fields = safe_strdup (ch);
+    l->line = line;
+    *last = l;
+    last = &l->next;
+
+    major = mutt_substrdup (buf, strchr (buf, '/'));
+    if ((m = hash_find (mf->majors, major)) != NULL)
+    {
+      m->last->next_major = l;
+      m->last = l;
+      FREE (&major);
+    }
+    else
+    {
+      m = safe_calloc (1, sizeof (MAILCAP_MAJOR));
+      m->major = major;
+      m->first = m->last = l;
+      hash_insert (mf->majors, m->major, m, 0);
+    }
+  }
+
+  safe_fclose (&fp);
+  return 0;
+}
+
+/* returns the parsed contents of the mailcap file at path, reading it
+ * if it isn't in memory or has changed since it was read */
+static MAILCAP_FILE *mailcap_get (const char *path)
+{
+  MAILCAP_FILE *mf, **pmf;
+  struct stat st;
+
+  for (pmf = &MailcapFiles; (mf = *pmf) != NULL; pmf = &mf->next)
+    if (!mutt_strcmp (mf->path, path))
+      break;
+
+  if (stat (path, &st) == -1)
+  {
+    if (mf)
+    {
+      *pmf = mf->next;
+      mailcap_free_lines (mf);
+      FREE (&mf->path);
+      FREE (&mf);
+    }
+    return NULL;
+  }
+
+  if (mf && mf->majors && mf->mtime == st.st_mtime &&
+      mf->size == st.st_size && mf->ino == st.st_ino)
+    return mf;
+
+  if (!mf)
+  {
+    mf = safe_calloc (1, sizeof (MAILCAP_FILE));
+    mf->path = safe_strdup (path);
+    *pmf = mf;
+  }
+  else
+    mailcap_free_lines (mf);
+
+  dprint (2, (debugfile, "Reading mailcap file: %s\n", path));
+  if (mailcap_load (mf) == -1)
+    return NULL;
+
+  mf->mtime = st.st_mtime;
+  mf->size = st.st_size;
+  mf->ino = st.st_ino;
+
+  return mf;
+}
+
 static int rfc1524_mailcap_parse (BODY *a,
-				  char *filename,
+				  MAILCAP_FILE *mf,
 				  char *type, 
 				  rfc1524_entry *entry,
 				  int opt)
 {
-  FILE *fp;
+  MAILCAP_LINE *l;
+  MAILCAP_MAJOR *m;
+  char major[SHORT_STRING];
   char *buf = NULL;
-  size_t buflen;
   char *ch;
   char *field;
   int found = FALSE;
@@ -184,7 +339,6 @@ static int rfc1524_mailcap_parse (BODY *a,
   int editcommand;
   int printcommand;
   int btlen;
-  int line = 0;
 
   /* rfc1524 mailcap file is of the format:
    * base/type; command; extradefs
@@ -202,23 +356,25 @@ static int rfc1524_mailcap_parse (BODY *a,
     return FALSE;
   btlen = ch - type;
 
-  if ((fp = fopen (filename, "r")) != NULL)
+  /* only entries filed under the same major type can match */
+  strfcpy (major, type, MIN (btlen + 1, sizeof (major)));
+  if ((m = hash_find (mf->majors, major)) != NULL)
   {
-    while (!found && (buf = mutt_read_line (buf, &buflen, fp, &line, M_CONT)) != NULL)
+    for (l = m->first; !found && l; l = l->next_major)
     {
-      /* ignore comments */
-      if (*buf == '#')
-	continue;
-      dprint (2, (debugfile, "mailcap entry: %s\n", buf));
+      dprint (2, (debugfile, "mailcap entry: %s\n", l->type));
 
       /* check type */
-      ch = get_field (buf);
-      if (ascii_strcasecmp (buf, type) &&
-	  (ascii_strncasecmp (buf, type, btlen) ||
-	   (buf[btlen] != 0 &&			/* implicit wild */
-	    mutt_strcmp (buf + btlen, "/*"))))	/* wildsubtype */
+      if (ascii_strcasecmp (l->type, type) &&
+	  (ascii_strncasecmp (l->type, type, btlen) ||
+	   (l->type[btlen] != 0 &&			/* implicit wild */
+	    mutt_strcmp (l->type + btlen, "/*"))))	/* wildsubtype */
 	continue;
 
+      /* get_field() splits the fields in place, so work on a copy */
+      mutt_str_replace (&buf, l->fields);
+      ch = buf;
+
       /* next field is the viewcommand */
       field = ch;
       ch = get_field (ch);
@@ -253,36 +409,36 @@ static int rfc1524_mailcap_parse (BODY *a,
 	{
 	  /* this compare most occur before compose to match correctly */
 	  if (get_field_text (field + 12, entry ? &entry->composetypecommand : NULL,
-			      type, filename, line))
+			      type, mf->path, l->line))
 	    composecommand = TRUE;
 	}
 	else if (!ascii_strncasecmp (field, "compose", 7))
 	{
 	  if (get_field_text (field + 7, entry ? &entry->composecommand : NULL,
-			      type, filename, line))
+			      type, mf->path, l->line))
 	    composecommand = TRUE;
 	}
 	else if (!ascii_strncasecmp (field, "print", 5))
 	{
 	  if (get_field_text (field + 5, entry ? &entry->printcommand : NULL,
-			      type, filename, line))
+			      type, mf->path, l->line))
 	    printcommand = TRUE;
 	}
 	else if (!ascii_strncasecmp (field, "edit", 4))
 	{
 	  if (get_field_text (field + 4, entry ? &entry->editcommand : NULL,
-			      type, filename, line))
+			      type, mf->path, l->line))
 	    editcommand = TRUE;
 	}
 	else if (!ascii_strncasecmp (field, "nametemplate", 12))
 	{
 	  get_field_text (field + 12, entry ? &entry->nametemplate : NULL,
-			  type, filename, line);
+			  type, mf->path, l->line);
 	}
 	else if (!ascii_strncasecmp (field, "x-convert", 9))
 	{
 	  get_field_text (field + 9, entry ? &entry->convert : NULL,
-			  type, filename, line);
+			  type, mf->path, l->line);
 	}
 	else if (!ascii_strncasecmp (field, "test", 4))
 	{
@@ -293,7 +449,7 @@ static int rfc1524_mailcap_parse (BODY *a,
 	  char *test_command = NULL;
 	  size_t len;
 
-	  if (get_field_text (field + 4, &test_command, type, filename, line)
+	  if (get_field_text (field + 4, &test_command, type, mf->path, l->line)
 	      && test_command)
 	  {
 	    len = mutt_strlen (test_command) + STRING;
@@ -346,9 +502,8 @@ static int rfc1524_mailcap_parse (BODY *a,
 	  entry->copiousoutput = 0;
 	}
       }
-    } /* while (!found && (buf = mutt_read_line ())) */
-    safe_fclose (&fp);
-  } /* if ((fp = fopen ())) */
+    } /* for (l = m->first; !found && l; l = l->next_major) */
+  }
   FREE (&buf);
   return found;
 }
@@ -381,6 +536,7 @@ void rfc1524_free_entry(rfc1524_entry **entry)
 int rfc1524_mailcap_lookup (BODY *a, char *type, rfc1524_entry *entry, int opt)
 {
   char path[_POSIX_PATH_MAX];
+  MAILCAP_FILE *mf;
   int x;
   int found = FALSE;
   char *curr = MailcapPath;
@@ -417,7 +573,8 @@ int rfc1524_mailcap_lookup (BODY *a, char *type, rfc1524_entry *entry, int opt)
     mutt_expand_path (path, sizeof (path));
 
     dprint(2,(debugfile,"Checking mailcap file: %s\n",path));
-    found = rfc1524_mailcap_parse (a, path, type, entry, opt);
+    if ((mf = mailcap_get (path)) != NULL)
+      found = rfc1524_mailcap_parse (a, mf, type, entry, opt);
   }
 
   if (entry && !found)
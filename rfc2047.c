@@ -65,6 +65,13 @@ static size_t convert_string (ICONV_CONST char *f, size_t flen,
   cd = mutt_iconv_open (to, from, 0);
   if (cd == (iconv_t)(-1))
     return (size_t)(-1);
+  if (mutt_iconv_passthrough (cd, f, flen))
+  {
+    mutt_iconv_close (cd);
+    *t = mutt_substrdup (f, f + flen);
+    *tlen = flen;
+    return 0;
+  }
   obl = 4 * flen + 1;
   ob = buf = safe_malloc (obl);
   n = iconv (cd, &f, &flen, &ob, &obl);
@@ -72,7 +79,7 @@ static size_t convert_string (ICONV_CONST char *f, size_t flen,
   {
     e = errno;
     FREE (&buf);
-    iconv_close (cd);
+    mutt_iconv_close (cd);
     errno = e;
     return (size_t)(-1);
   }
@@ -82,7 +89,7 @@ static size_t convert_string (ICONV_CONST char *f, size_t flen,
 
   safe_realloc (&buf, ob - buf + 1);
   *t = buf;
-  iconv_close (cd);
+  mutt_iconv_close (cd);
 
   return n;
 }
@@ -287,11 +294,11 @@ static size_t try_block (ICONV_CONST char *d, size_t dlen,
 	iconv (cd, 0, 0, &ob, &obl) == (size_t)(-1))
     {
       assert (errno == E2BIG);
-      iconv_close (cd);
+      mutt_iconv_close (cd);
       assert (ib > d);
       return (ib - d == dlen) ? dlen : ib - d + 1;
     }
-    iconv_close (cd);
+    mutt_iconv_close (cd);
   }
   else
   {
@@ -357,7 +364,7 @@ static size_t encode_block (char *s, char *d, size_t dlen,
     n1 = iconv (cd, &ib, &ibl, &ob, &obl);
     n2 = iconv (cd, 0, 0, &ob, &obl);
     assert (n1 != (size_t)(-1) && n2 != (size_t)(-1));
-    iconv_close (cd);
+    mutt_iconv_close (cd);
     return (*encoder) (s, buf1, ob - buf1, tocode);
   }
   else
@@ -601,7 +608,7 @@ void _rfc2047_encode_string (char **pd, int encode_specials, int col)
 		  Charset, charsets, &e, &elen,
 		  encode_specials ? RFC822Specials : NULL);
 
-  FREE (pd);		/* __FREE_CHECKED__ */
+  mutt_str_unintern (pd);
   *pd = e;
 }
 
@@ -886,7 +893,7 @@ void rfc2047_decode (char **pd)
   }
   *d = 0;
 
-  FREE (pd);		/* __FREE_CHECKED__ */
+  mutt_str_unintern (pd);
   *pd = d0;
   mutt_str_adjust (pd);
 }
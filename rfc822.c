@@ -31,6 +31,7 @@
 #define safe_malloc malloc
 #define SKIPWS(x) while(isspace(*x))x++
 #define FREE(x) safe_free(x)
+#define mutt_str_unintern(x) FREE(x)
 #define ISSPACE isspace
 #define strfcpy(a,b,c) {if (c) {strncpy(a,b,c);a[c-1]=0;}}
 #define LONG_STRING 1024
@@ -46,7 +47,34 @@
 
 
 const char RFC822Specials[] = "@.,:;<>[]\\\"()";
-#define is_special(x) strchr(RFC822Specials,x)
+
+/* same as strchr (RFC822Specials, c), which is also true for NUL, but
+ * without searching the string for every character of a header */
+static inline int is_special (char c)
+{
+  switch (c)
+  {
+    case '@': case '.': case ',': case ':': case ';': case '<': case '>':
+    case '[': case ']': case '\\': case '"': case '(': case ')': case '\0':
+      return 1;
+  }
+  return 0;
+}
+
+/* The tokenizer below finds each run of ordinary characters in the input
+ * and copies it in one go, rather than a character at a time.  Whatever
+ * doesn't fit below max is dropped. */
+static inline void
+add_span (char *token, size_t *len, size_t max, const char *s, size_t n)
+{
+  if (*len < max)
+  {
+    if (n > max - *len)
+      n = max - *len;
+    memcpy (token + *len, s, n);
+    *len += n;
+  }
+}
 
 int RFC822Error = 0;
 
@@ -84,8 +112,8 @@ static void rfc822_dequote_comment (char *s)
 
 static void free_address (ADDRESS *a)
 {
-  FREE(&a->personal);
-  FREE(&a->mailbox);
+  mutt_str_unintern (&a->personal);
+  mutt_str_unintern (&a->mailbox);
 #ifdef EXACT_ADDRESS
   FREE(&a->val);
 #endif
@@ -133,8 +161,8 @@ void rfc822_free_address (ADDRESS **p)
 #ifdef EXACT_ADDRESS
     FREE (&t->val);
 #endif
-    FREE (&t->personal);
-    FREE (&t->mailbox);
+    mutt_str_unintern (&t->personal);
+    mutt_str_unintern (&t->mailbox);
     FREE (&t);
   }
 }
@@ -143,10 +171,20 @@ static const char *
 parse_comment (const char *s,
 	       char *comment, size_t *commentlen, size_t commentmax)
 {
+  const char *p;
   int level = 1;
   
   while (*s && level)
   {
+    for (p = s; *p && *p != '(' && *p != ')' && *p != '\\'; p++)
+      ;
+    if (p > s)
+    {
+      add_span (comment, commentlen, commentmax, s, p - s);
+      s = p;
+      continue;
+    }
+
     if (*s == '(')
       level++;
     else if (*s == ')')
@@ -177,25 +215,38 @@ parse_comment (const char *s,
 static const char *
 parse_quote (const char *s, char *token, size_t *tokenlen, size_t tokenmax)
 {
+  const char *p;
+  size_t len;
+
   if (*tokenlen < tokenmax)
     token[(*tokenlen)++] = '"';
   while (*s)
   {
-    if (*tokenlen < tokenmax)
-      token[*tokenlen] = *s;
+    for (p = s; *p && *p != '"' && *p != '\\'; p++)
+      ;
+    if (p > s)
+    {
+      /* unlike the other tokens, a quoted string is counted in full */
+      len = *tokenlen + (p - s);
+      add_span (token, tokenlen, tokenmax, s, p - s);
+      *tokenlen = len;
+      s = p;
+      continue;
+    }
+
     if (*s == '"')
     {
+      if (*tokenlen < tokenmax)
+	token[*tokenlen] = '"';
       (*tokenlen)++;
       return (s + 1);
     }
-    if (*s == '\\')
-    {
-      if (!*++s)
-	break;
 
-      if (*tokenlen < tokenmax)
-	token[*tokenlen] = *s;
-    }
+    /* backslash: take the next character literally */
+    if (!*++s)
+      break;
+    if (*tokenlen < tokenmax)
+      token[*tokenlen] = *s;
     (*tokenlen)++;
     s++;
   }
@@ -206,6 +257,8 @@ parse_quote (const char *s, char *token, size_t *tokenlen, size_t tokenmax)
 static const char *
 next_token (const char *s, char *token, size_t *tokenlen, size_t tokenmax)
 {
+  const char *p;
+
   if (*s == '(')
     return (parse_comment (s + 1, token, tokenlen, tokenmax));
   if (*s == '"')
@@ -216,15 +269,10 @@ next_token (const char *s, char *token, size_t *tokenlen, size_t tokenmax)
       token[(*tokenlen)++] = *s;
     return (s + 1);
   }
-  while (*s)
-  {
-    if (ISSPACE ((unsigned char) *s) || is_special (*s))
-      break;
-    if (*tokenlen < tokenmax)
-      token[(*tokenlen)++] = *s;
-    s++;
-  }
-  return s;
+  for (p = s; *p && !ISSPACE ((unsigned char) *p) && !is_special (*p); p++)
+    ;
+  add_span (token, tokenlen, tokenmax, s, p - s);
+  return p;
 }
 
 static const char *
@@ -555,7 +603,7 @@ void rfc822_qualify (ADDRESS *addr, const char *host)
     {
       p = safe_malloc (mutt_strlen (addr->mailbox) + mutt_strlen (host) + 2);
       sprintf (p, "%s@%s", addr->mailbox, host);	/* __SPRINTF_CHECKED__ */
-      FREE (&addr->mailbox);
+      mutt_str_unintern (&addr->mailbox);
       addr->mailbox = p;
     }
 }
@@ -36,10 +36,209 @@ typedef struct score_t
 
 static SCORE *Score = NULL;
 
-void mutt_check_rescore (CONTEXT *ctx)
+/*
+ * Changes to the score rules are recorded in a log, one entry per pattern,
+ * describing how the rules differ from the ones in effect at ScoreLogBase.
+ * Messages scored at ScoreLogBase only need the changed patterns evaluated
+ * to bring their score up to date, and changes which cancel each other
+ * out (e.g. "unscore *" followed by the same rules in a folder-hook) cost
+ * nothing at all.  Exact rules depend on the order of the rules, so any
+ * change involving one forces a full rescore.
+ *
+ * This only holds while the message itself is unchanged: a message whose
+ * flags or headers changed since it was scored (score_stale) is rescored
+ * in full, and so is every message when a rule looks at other messages,
+ * at the score itself, or at configuration (lists, alternates, groups),
+ * since their result can change without the message being touched.
+ */
+typedef struct score_change
+{
+  char *str;
+  pattern_t *pat;	/* compiled on demand when rescoring */
+  int old_val;
+  int new_val;
+  unsigned int old_exact : 1;
+  unsigned int new_exact : 1;
+  unsigned int moved : 1;	/* rule was removed, and maybe added again */
+  struct score_change *next;
+} SCORE_CHANGE;
+
+static SCORE_CHANGE *ScoreLog = NULL;
+static unsigned int ScoreGen = 1;
+static unsigned int ScoreLogBase = 1;
+
+#define score_is_exact(v,e) ((e) || (v) == 9999 || (v) == -9999)
+
+static void score_log_change (const char *str, SCORE *rule, int removed,
+			      int val, int exact)
 {
-  int i;
+  SCORE_CHANGE *c;
+
+  for (c = ScoreLog; c; c = c->next)
+    if (mutt_strcmp (str, c->str) == 0)
+      break;
+
+  if (!c)
+  {
+    c = safe_calloc (1, sizeof (SCORE_CHANGE));
+    c->str = safe_strdup (str);
+    if (rule)
+    {
+      c->old_val = rule->val;
+      c->old_exact = score_is_exact (rule->val, rule->exact);
+    }
+    c->next = ScoreLog;
+    ScoreLog = c;
+  }
+
+  if (removed)
+  {
+    c->new_val = 0;
+    c->new_exact = 0;
+    c->moved = 1;
+  }
+  else
+  {
+    c->new_val = val;
+    c->new_exact = score_is_exact (val, exact);
+  }
+
+  if (!++ScoreGen)
+    ScoreGen = 1;
+}
+
+static void score_free_log (void)
+{
+  SCORE_CHANGE *c;
+
+  while ((c = ScoreLog) != NULL)
+  {
+    ScoreLog = c->next;
+    FREE (&c->str);
+    mutt_pattern_free (&c->pat);
+    FREE (&c);
+  }
+  ScoreLogBase = ScoreGen;
+}
 
+/* can the pattern's result change without the message changing? */
+static int score_pat_is_local (pattern_t *pat)
+{
+  for (; pat; pat = pat->next)
+  {
+    if (pat->groupmatch)
+      return 0;
+    switch (pat->op)
+    {
+      case M_THREAD:
+      case M_COLLAPSED:
+      case M_DUPLICATED:
+      case M_UNREFERENCED:
+      case M_SCORE:
+      case M_LIST:
+      case M_SUBSCRIBED_LIST:
+      case M_PERSONAL_RECIP:
+      case M_PERSONAL_FROM:
+	return 0;
+    }
+    if (!score_pat_is_local (pat->child))
+      return 0;
+  }
+  return 1;
+}
+
+/* clamp the raw score of a message and apply the score thresholds */
+static void score_apply (CONTEXT *ctx, HEADER *hdr, int upd_ctx)
+{
+  hdr->score = hdr->score_raw < 0 ? 0 : hdr->score_raw;
+  hdr->score_gen = ScoreGen;
+
+  /* flags changed by the thresholds below make the score stale again */
+  hdr->score_stale = 0;
+
+  if (hdr->score <= ScoreThresholdDelete)
+    _mutt_set_flag (ctx, hdr, M_DELETE, 1, upd_ctx);
+  if (hdr->score <= ScoreThresholdRead)
+    _mutt_set_flag (ctx, hdr, M_READ, 1, upd_ctx);
+  if (hdr->score >= ScoreThresholdFlag)
+    _mutt_set_flag (ctx, hdr, M_FLAG, 1, upd_ctx);
+}
+
+/*
+ * Bring the scores of all messages in ctx up to date with the current
+ * score rules, evaluating as few patterns as possible.
+ */
+void mutt_rescore_context (CONTEXT *ctx)
+{
+  SCORE_CHANGE *c, **last;
+  SCORE *rule;
+  BUFFER err;
+  char errbuf[STRING];
+  HEADER *h;
+  int i, full = 0, compiled = 0;
+
+  /* drop the changes which cancelled out */
+  for (last = &ScoreLog; (c = *last) != NULL; )
+  {
+    if (c->old_val == c->new_val && c->old_exact == c->new_exact &&
+	!(c->old_exact && c->moved))
+    {
+      *last = c->next;
+      FREE (&c->str);
+      mutt_pattern_free (&c->pat);
+      FREE (&c);
+      continue;
+    }
+
+    if (c->old_exact || c->new_exact)
+      full = 1;
+    last = &c->next;
+  }
+
+  for (rule = Score; rule && !full; rule = rule->next)
+    if (!score_pat_is_local (rule->pat))
+      full = 1;
+
+  for (i = 0; ctx && i < ctx->msgcount; i++)
+  {
+    h = ctx->hdrs[i];
+    if (h->score_gen == ScoreGen)
+      continue;
+
+    if (!full && !compiled)
+    {
+      for (c = ScoreLog; c && !full; c = c->next)
+      {
+	err.data = errbuf;
+	err.dsize = sizeof (errbuf);
+	if ((c->pat = mutt_pattern_comp (c->str, 0, &err)) == NULL ||
+	    !score_pat_is_local (c->pat))
+	  full = 1;
+      }
+      compiled = 1;
+    }
+
+    if (full || h->score_gen != ScoreLogBase || h->score_stale)
+    {
+      mutt_score_message (ctx, h, 1);
+      continue;
+    }
+
+    /* an exact rule decided this score, additive rules can't change it */
+    if (!h->score_exact)
+    {
+      for (c = ScoreLog; c; c = c->next)
+	if (mutt_pattern_exec (c->pat, 0, NULL, h) > 0)
+	  h->score_raw += c->new_val - c->old_val;
+    }
+    score_apply (ctx, h, 1);
+  }
+
+  score_free_log ();
+}
+
+void mutt_check_rescore (CONTEXT *ctx)
+{
   if (option (OPTNEEDRESCORE) && option (OPTSCORE))
   {
     if ((Sort & SORT_MASK) == SORT_SCORE ||
@@ -54,11 +253,11 @@ void mutt_check_rescore (CONTEXT *ctx)
     set_option (OPTFORCEREDRAWINDEX);
     set_option (OPTFORCEREDRAWPAGER);
 
-    for (i = 0; ctx && i < ctx->msgcount; i++)
-    {
-      mutt_score_message (ctx, ctx->hdrs[i], 1);
-      ctx->hdrs[i]->pair = 0;
-    }
+    mutt_rescore_context (ctx);
+
+    /* score patterns (~n) may be used in index colors */
+    mutt_invalidate_index_colors ();
+    mutt_invalidate_index_lines ();
   }
   unset_option (OPTNEEDRESCORE);
 }
@@ -68,6 +267,7 @@ int mutt_parse_score (BUFFER *buf, BUFFER *s, unsigned long data, BUFFER *err)
   SCORE *ptr, *last;
   char *pattern, *pc;
   struct pattern_t *pat;
+  int val, exact = 0;
 
   mutt_extract_token (buf, s, 0);
   if (!MoreArgs (s))
@@ -85,6 +285,19 @@ int mutt_parse_score (BUFFER *buf, BUFFER *s, unsigned long data, BUFFER *err)
     return (-1);
   }
 
+  pc = buf->data;
+  if (*pc == '=')
+  {
+    exact = 1;
+    pc++;
+  }
+  if (mutt_atoi (pc, &val) < 0)
+  {
+    FREE (&pattern);
+    strfcpy (err->data, _("Error: score: invalid number"), err->dsize);
+    return (-1);
+  }
+
   /* look for an existing entry and update the value, else add it to the end
      of the list */
   for (ptr = Score, last = NULL; ptr; last = ptr, ptr = ptr->next)
@@ -104,24 +317,22 @@ int mutt_parse_score (BUFFER *buf, BUFFER *s, unsigned long data, BUFFER *err)
       Score = ptr;
     ptr->pat = pat;
     ptr->str = pattern;
-  } else
+    score_log_change (ptr->str, NULL, 0, val, exact);
+  }
+  else
+  {
     /* 'buf' arg was cleared and 'pattern' holds the only reference;
      * as here 'ptr' != NULL -> update the value only in which case
      * ptr->str already has the string, so pattern should be freed.
      */
     FREE (&pattern);
-  pc = buf->data;
-  if (*pc == '=')
-  {
-    ptr->exact = 1;
-    pc++;
-  }
-  if (mutt_atoi (pc, &ptr->val) < 0)
-  {
-    FREE (&pattern);
-    strfcpy (err->data, _("Error: score: invalid number"), err->dsize);
-    return (-1);
+    /* hooks often repeat the very same rule */
+    if (ptr->val == val && ptr->exact == exact)
+      return 0;
+    score_log_change (ptr->str, ptr, 0, val, exact);
   }
+  ptr->val = val;
+  ptr->exact = exact;
   set_option (OPTNEEDRESCORE);
   return 0;
 }
@@ -130,28 +341,23 @@ void mutt_score_message (CONTEXT *ctx, HEADER *hdr, int upd_ctx)
 {
   SCORE *tmp;
 
-  hdr->score = 0; /* in case of re-scoring */
+  hdr->score_raw = 0; /* in case of re-scoring */
+  hdr->score_exact = 0;
   for (tmp = Score; tmp; tmp = tmp->next)
   {
     if (mutt_pattern_exec (tmp->pat, 0, NULL, hdr) > 0)
     {
-      if (tmp->exact || tmp->val == 9999 || tmp->val == -9999)
+      if (score_is_exact (tmp->val, tmp->exact))
       {
-	hdr->score = tmp->val;
+	hdr->score_raw = tmp->val;
+	hdr->score_exact = 1;
 	break;
       }
-      hdr->score += tmp->val;
+      hdr->score_raw += tmp->val;
     }
   }
-  if (hdr->score < 0)
-    hdr->score = 0;
-  
-  if (hdr->score <= ScoreThresholdDelete)
-    _mutt_set_flag (ctx, hdr, M_DELETE, 1, upd_ctx);
-  if (hdr->score <= ScoreThresholdRead)
-    _mutt_set_flag (ctx, hdr, M_READ, 1, upd_ctx);
-  if (hdr->score >= ScoreThresholdFlag)
-    _mutt_set_flag (ctx, hdr, M_FLAG, 1, upd_ctx);
+
+  score_apply (ctx, hdr, upd_ctx);
 }
 
 int mutt_parse_unscore (BUFFER *buf, BUFFER *s, unsigned long data, BUFFER *err)
@@ -167,7 +373,9 @@ int mutt_parse_unscore (BUFFER *buf, BUFFER *s, unsigned long data, BUFFER *err)
       {
 	last = tmp;
 	tmp = tmp->next;
+	score_log_change (last->str, last, 1, 0, 0);
 	mutt_pattern_free (&last->pat);
+	FREE (&last->str);
 	FREE (&last);
       }
       Score = NULL;
@@ -182,7 +390,9 @@ int mutt_parse_unscore (BUFFER *buf, BUFFER *s, unsigned long data, BUFFER *err)
 	    last->next = tmp->next;
 	  else
 	    Score = tmp->next;
+	  score_log_change (tmp->str, tmp, 1, 0, 0);
 	  mutt_pattern_free (&tmp->pat);
+	  FREE (&tmp->str);
 	  FREE (&tmp);
 	  /* there should only be one score per pattern, so we can stop here */
 	  break;
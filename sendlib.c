@@ -79,13 +79,40 @@ static char MsgIdPfx = 'A';
 
 static void transform_to_7bit (BODY *a, FILE *fpin);
 
+/* characters which encode_quoted() passes through unchanged */
+#define QP_LITERAL(c) ((c) == '\t' || ((c) >= 32 && (c) <= 126 && (c) != '='))
+
 static void encode_quoted (FGETCONV * fc, FILE *fout, int istext)
 {
   int c, linelen = 0;
   char line[77], savechar;
+  char bufc[LONG_STRING];
+  size_t i = 0, n = 0, k;
 
-  while ((c = fgetconv (fc)) != EOF)
+  FOREVER
   {
+    if (i == n)
+    {
+      if (!(n = fgetconvn (bufc, sizeof (bufc), fc)))
+	break;
+      i = 0;
+    }
+    c = (unsigned char) bufc[i++];
+
+    /* In the middle of a line, where neither wrapping nor the "From" and
+     * "." escapes below can apply, copy a run of literals in one go. */
+    if (linelen > 4 && linelen < 76 && QP_LITERAL (c))
+    {
+      line[linelen++] = c;
+      for (k = i; k < n && k - i < 76 - linelen
+		  && QP_LITERAL ((unsigned char) bufc[k]); k++)
+	;
+      memcpy (line + linelen, bufc + i, k - i);
+      linelen += k - i;
+      i = k;
+      continue;
+    }
+
     /* Wrap the line if needed. */
     if (linelen == 76 && ((istext && c != '\n') || !istext))
     {
@@ -211,75 +238,73 @@ static void encode_quoted (FGETCONV * fc, FILE *fout, int istext)
   }
 }
 
-static char b64_buffer[3];
-static short b64_num;
-static short b64_linelen;
+#define B64_LINELEN 72
+#define B64_BLOCK 3 * 512
 
-static void b64_flush(FILE *fout)
+/* Encode the len bytes (a multiple of 3) at in into out, starting a new
+ * line whenever *linelen reaches B64_LINELEN.  Returns the number of
+ * characters written, at most 4 * len / 3 + len / 54 + 1.
+ */
+static size_t b64_encode_block (char *out, const unsigned char *in,
+				size_t len, int *linelen)
 {
-  short i;
-
-  if(!b64_num)
-    return;
-
-  if(b64_linelen >= 72)
-  {
-    fputc('\n', fout);
-    b64_linelen = 0;
-  }
-
-  for(i = b64_num; i < 3; i++)
-    b64_buffer[i] = '\0';
+  char *o = out;
 
-  fputc(B64Chars[(b64_buffer[0] >> 2) & 0x3f], fout);
-  b64_linelen++;
-  fputc(B64Chars[((b64_buffer[0] & 0x3) << 4) | ((b64_buffer[1] >> 4) & 0xf) ], fout);
-  b64_linelen++;
-
-  if(b64_num > 1)
+  for (; len >= 3; len -= 3, in += 3)
   {
-    fputc(B64Chars[((b64_buffer[1] & 0xf) << 2) | ((b64_buffer[2] >> 6) & 0x3) ], fout);
-    b64_linelen++;
-    if(b64_num > 2)
+    if (*linelen >= B64_LINELEN)
     {
-      fputc(B64Chars[b64_buffer[2] & 0x3f], fout);
-      b64_linelen++;
+      *o++ = '\n';
+      *linelen = 0;
     }
+    *o++ = B64Chars[in[0] >> 2];
+    *o++ = B64Chars[((in[0] & 0x3) << 4) | (in[1] >> 4)];
+    *o++ = B64Chars[((in[1] & 0xf) << 2) | (in[2] >> 6)];
+    *o++ = B64Chars[in[2] & 0x3f];
+    *linelen += 4;
   }
 
-  while(b64_linelen % 4)
-  {
-    fputc('=', fout);
-    b64_linelen++;
-  }
-
-  b64_num = 0;
-}
-
-
-static void b64_putc(char c, FILE *fout)
-{
-  if(b64_num == 3)
-    b64_flush(fout);
-
-  b64_buffer[b64_num++] = c;
+  return o - out;
 }
 
-
 static void encode_base64 (FGETCONV * fc, FILE *fout, int istext)
 {
-  int ch, ch1 = EOF;
+  char bufc[B64_BLOCK];
+  unsigned char bufi[2 * B64_BLOCK + 2];	/* room for a CR per LF */
+  char bufo[4 * (2 * B64_BLOCK + 2) / 3 + (2 * B64_BLOCK + 2) / 54 + 8];
+  size_t n, i, l = 0, full;
+  int ch1 = EOF, linelen = 0;
+
+  while ((n = fgetconvn (bufc, sizeof (bufc), fc)) > 0)
+  {
+    /* l < 3 bytes are left over from the previous block */
+    for (i = 0; i < n; i++)
+    {
+      if (istext && bufc[i] == '\n' && ch1 != '\r')
+	bufi[l++] = '\r';
+      bufi[l++] = bufc[i];
+      ch1 = bufc[i];
+    }
 
-  b64_num = b64_linelen = 0;
+    full = l - l % 3;
+    fwrite (bufo, 1, b64_encode_block (bufo, bufi, full, &linelen), fout);
+    memmove (bufi, bufi + full, l - full);
+    l -= full;
+  }
 
-  while ((ch = fgetconv (fc)) != EOF)
+  if (l)
   {
-    if (istext && ch == '\n' && ch1 != '\r')
-      b64_putc('\r', fout);
-    b64_putc(ch, fout);
-    ch1 = ch;
+    unsigned char last[3];
+
+    memset (last, 0, sizeof (last));
+    memcpy (last, bufi, l);
+    n = b64_encode_block (bufo, last, 3, &linelen);
+    /* replace the characters which only encode padding */
+    bufo[n - 1] = '=';
+    if (l == 1)
+      bufo[n - 2] = '=';
+    fwrite (bufo, 1, n, fout);
   }
-  b64_flush(fout);
   fputc('\n', fout);
 }
 
@@ -738,9 +763,9 @@ static size_t convert_file_to (FILE *file, const char *fromcode,
 
   for (i = 0; i < ncodes; i++)
     if (cd[i] != (iconv_t)(-1))
-      iconv_close (cd[i]);
+      mutt_iconv_close (cd[i]);
 
-  iconv_close (cd1);
+  mutt_iconv_close (cd1);
   FREE (&cd);
   FREE (&infos);
   FREE (&score);
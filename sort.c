@@ -250,6 +250,9 @@ void mutt_sort_headers (CONTEXT *ctx, int init)
   if (!ctx)
     return;
 
+  mutt_invalidate_index_lines ();
+  mutt_invalidate_thread_counts (ctx);
+
   if (!ctx->msgcount)
   {
     /* this function gets called by mutt_sync_mailbox(), which may have just
@@ -265,10 +268,7 @@ void mutt_sort_headers (CONTEXT *ctx, int init)
     mutt_message _("Sorting mailbox...");
 
   if (option (OPTNEEDRESCORE) && option (OPTSCORE))
-  {
-    for (i = 0; i < ctx->msgcount; i++)
-      mutt_score_message (ctx, ctx->hdrs[i], 1);
-  }
+    mutt_rescore_context (ctx);
   unset_option (OPTNEEDRESCORE);
 
   if (option (OPTRESORTINIT))
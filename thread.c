@@ -23,6 +23,10 @@
 #include "mutt.h"
 #include "sort.h"
 
+#ifdef USE_HCACHE
+#include "hcache.h"
+#endif
+
 #include <string.h>
 #include <ctype.h>
 
@@ -239,6 +243,8 @@ void mutt_draw_tree (CONTEXT *ctx)
   int depth = 0, start_depth = 0, max_depth = 0, width = option (OPTNARROWTREE) ? 1 : 2;
   THREAD *nextdisp = NULL, *pseudo = NULL, *parent = NULL, *tree = ctx->tree;
 
+  mutt_invalidate_index_lines ();
+
   /* Do the visibility calculations and free the old thread chars.
    * From now on we can simply ignore invisible subtrees
    */
@@ -1075,6 +1081,11 @@ int _mutt_aside_thread (HEADER *hdr, short dir, short subthreads)
 int mutt_parent_message (CONTEXT *ctx, HEADER *hdr)
 {
   THREAD *thread;
+#ifdef USE_HCACHE
+  ENVELOPE *env = hdr->env;
+  char *parent = NULL;
+  char folder[_POSIX_PATH_MAX];
+#endif
 
   if ((Sort & SORT_MASK) != SORT_THREADS)
   {
@@ -1096,15 +1107,128 @@ int mutt_parent_message (CONTEXT *ctx, HEADER *hdr)
     }
   }
   
+#ifdef USE_HCACHE
+  if (env->in_reply_to)
+    parent = env->in_reply_to->data;
+  else if (env->references)
+    parent = env->references->data;
+
+  if (parent &&
+      mutt_hcache_msgid_lookup (parent, ctx->path, folder, sizeof (folder)) == 0)
+  {
+    mutt_pretty_mailbox (folder, sizeof (folder));
+    mutt_error (_("Parent message is in %s."), folder);
+    return (-1);
+  }
+#endif
+
   mutt_error _("Parent message is not available.");
   return (-1);
 }
 
+void mutt_invalidate_thread_counts (CONTEXT *ctx)
+{
+  if (!++ctx->thread_gen)
+    ctx->thread_gen = 1;
+}
+
+/* Return the top level node of the thread of h with its aggregates
+ * brought up to date.  They are recomputed with a single walk of the
+ * thread when they are stale, so looking them up for every row of the
+ * index doesn't cost a walk of the whole thread each time.
+ */
+static THREAD *thread_counts (CONTEXT *ctx, HEADER *h)
+{
+  THREAD *thread, *top;
+  HEADER *cur;
+
+  top = h->thread;
+  while (top->parent)
+    top = top->parent;
+
+  if (top->count_gen && top->count_gen == ctx->thread_gen)
+    return top;
+
+  top->unread_new = top->unread_old = top->hidden = 0;
+  for (thread = top; thread; )
+  {
+    if ((cur = thread->message) && (!ctx->pattern || cur->limited))
+    {
+      if (!cur->read)
+      {
+	if (cur->old)
+	  top->unread_old++;
+	else
+	  top->unread_new++;
+      }
+      if (cur->virtual == -1)
+	top->hidden++;
+    }
+
+    if (thread->child)
+      thread = thread->child;
+    else
+    {
+      while (thread != top && !thread->next)
+	thread = thread->parent;
+      thread = (thread == top) ? NULL : thread->next;
+    }
+  }
+  top->count_gen = ctx->thread_gen;
+
+  return top;
+}
+
+/* Returns 1 if the thread of h contains new messages, 2 if it only
+ * contains old unread ones, and 0 otherwise. */
+int mutt_thread_contains_unread (CONTEXT *ctx, HEADER *h)
+{
+  THREAD *top;
+
+  if ((Sort & SORT_MASK) != SORT_THREADS || !h->thread)
+    return _mutt_traverse_thread (ctx, h, M_THREAD_UNREAD);
+
+  top = thread_counts (ctx, h);
+  return top->unread_new ? 1 : (top->unread_old ? 2 : 0);
+}
+
+/* The read or old flag of h has been changed from read and old: adjust
+ * the aggregates of its thread, if they are in use. */
+void mutt_thread_update_counts (CONTEXT *ctx, HEADER *h, int read, int old)
+{
+  THREAD *top;
+
+  if (!h->thread || !ctx->thread_gen || (ctx->pattern && !h->limited))
+    return;
+
+  top = h->thread;
+  while (top->parent)
+    top = top->parent;
+  if (top->count_gen != ctx->thread_gen)
+    return;
+
+  if (!read)
+  {
+    if (old)
+      top->unread_old--;
+    else
+      top->unread_new--;
+  }
+  if (!h->read)
+  {
+    if (h->old)
+      top->unread_old++;
+    else
+      top->unread_new++;
+  }
+}
+
 void mutt_set_virtual (CONTEXT *ctx)
 {
   int i;
   HEADER *cur;
 
+  mutt_invalidate_index_lines ();
   ctx->vcount = 0;
   ctx->vsize = 0;
 
@@ -1117,7 +1241,97 @@ void mutt_set_virtual (CONTEXT *ctx)
       ctx->v2r[ctx->vcount] = i;
       ctx->vcount++;
       ctx->vsize += cur->content->length + cur->content->offset - cur->content->hdr_offset;
-      cur->num_hidden = mutt_get_hidden (ctx, cur);
+      /* only looked at for collapsed threads, which show one message */
+      cur->num_hidden = cur->collapsed ? thread_counts (ctx, cur)->hidden + 1 : 1;
+    }
+  }
+}
+
+/* Renumber the visible messages after the thread of cur has been
+ * collapsed or uncollapsed.  The messages of a thread are next to each
+ * other in ctx->hdrs, so only the thread's part of ctx->v2r is rebuilt
+ * and the visible messages behind it are moved.
+ */
+void mutt_set_virtual_thread (CONTEXT *ctx, HEADER *cur)
+{
+  THREAD *thread, *top;
+  HEADER *h;
+  int first = ctx->msgcount, last = -1, count = 0;
+  int lo, hi, mid, i, vfirst, vlast, nvisible, delta;
+
+  top = cur->thread;
+  while (top->parent)
+    top = top->parent;
+
+  for (thread = top; thread; )
+  {
+    if (thread->message)
+    {
+      count++;
+      if (thread->message->msgno < first)
+	first = thread->message->msgno;
+      if (thread->message->msgno > last)
+	last = thread->message->msgno;
+    }
+
+    if (thread->child)
+      thread = thread->child;
+    else
+    {
+      while (thread != top && !thread->next)
+	thread = thread->parent;
+      thread = (thread == top) ? NULL : thread->next;
+    }
+  }
+
+  /* the thread isn't where we expect it, so start from scratch */
+  if (!count || last - first + 1 != count)
+  {
+    mutt_set_virtual (ctx);
+    return;
+  }
+
+  mutt_invalidate_index_lines ();
+
+  /* v2r is still in order outside of the thread: find its old range */
+  for (lo = 0, hi = ctx->vcount; lo < hi; )
+  {
+    mid = (lo + hi) / 2;
+    if (ctx->v2r[mid] < first)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  vfirst = lo;
+  for (vlast = vfirst; vlast < ctx->vcount && ctx->v2r[vlast] <= last; vlast++)
+  {
+    h = ctx->hdrs[ctx->v2r[vlast]];
+    ctx->vsize -= h->content->length + h->content->offset - h->content->hdr_offset;
+  }
+
+  for (nvisible = 0, i = first; i <= last; i++)
+    if (ctx->hdrs[i]->virtual >= 0)
+      nvisible++;
+
+  delta = nvisible - (vlast - vfirst);
+  if (delta)
+  {
+    memmove (ctx->v2r + vlast + delta, ctx->v2r + vlast,
+	     (ctx->vcount - vlast) * sizeof (*ctx->v2r));
+    ctx->vcount += delta;
+    for (i = vlast + delta; i < ctx->vcount; i++)
+      ctx->hdrs[ctx->v2r[i]]->virtual = i;
+  }
+
+  for (i = first; i <= last; i++)
+  {
+    h = ctx->hdrs[i];
+    if (h->virtual >= 0)
+    {
+      h->virtual = vfirst;
+      ctx->v2r[vfirst++] = i;
+      ctx->vsize += h->content->length + h->content->offset - h->content->hdr_offset;
+      h->num_hidden = h->collapsed ? thread_counts (ctx, h)->hidden + 1 : 1;
     }
   }
 }
@@ -1147,6 +1361,10 @@ int _mutt_traverse_thread (CONTEXT *ctx, HEADER *cur, int flag)
   cur = thread->message;
   minmsgno = cur->msgno;
 
+  /* collapsing changes which messages of the thread are hidden */
+  if (flag & (M_THREAD_COLLAPSE | M_THREAD_UNCOLLAPSE))
+    top->count_gen = 0;
+
   if (!cur->read && CHECK_LIMIT)
   {
     if (cur->old)
@@ -1165,7 +1383,8 @@ int _mutt_traverse_thread (CONTEXT *ctx, HEADER *cur, int flag)
 
   if (flag & (M_THREAD_COLLAPSE | M_THREAD_UNCOLLAPSE))
   {
-    cur->pair = 0; /* force index entry's color to be re-evaluated */
+    cur->color_gen = 0; /* force index entry's color to be re-evaluated */
+    cur->line_gen = 0;
     cur->collapsed = flag & M_THREAD_COLLAPSE;
     if (cur->virtual != -1)
     {
@@ -1196,7 +1415,8 @@ int _mutt_traverse_thread (CONTEXT *ctx, HEADER *cur, int flag)
     {
       if (flag & (M_THREAD_COLLAPSE | M_THREAD_UNCOLLAPSE))
       {
-	cur->pair = 0; /* force index entry's color to be re-evaluated */
+	cur->color_gen = 0; /* force index entry's color to be re-evaluated */
+	cur->line_gen = 0;
 	cur->collapsed = flag & M_THREAD_COLLAPSE;
 	if (!roothdr && CHECK_LIMIT)
 	{
@@ -18,6 +18,8 @@
  * - Adapted for Mutt by Edmund Grimley Evans.
  * - Changed 'first'/'last' members of combined[] to wchar_t from
  *   unsigned short to fix compiler warnings, 2007-11-13, Rocco Rutte
+ * - Look up the widths of BMP characters in a two-level table which is
+ *   built from the interval search on first use.
  */
 
 #if HAVE_CONFIG_H
@@ -63,7 +65,7 @@
  * in ISO 10646.
  */
 
-int wcwidth_ucs(wchar_t ucs)
+static int wcwidth_ucs_search(wchar_t ucs)
 {
   /* sorted list of non-overlapping intervals of non-spacing characters */
   /* generated by "uniset +cat=Me +cat=Mn +cat=Cf -00AD +1160-11FF +200B c" */
@@ -167,6 +169,45 @@ int wcwidth_ucs(wchar_t ucs)
       (ucs >= 0x30000 && ucs <= 0x3fffd)));
 }
 
+/* Widths of the characters below U+10000: the high byte of a character
+ * selects a block of 256 widths, and blocks with the same contents share
+ * their storage.  Apart from a few dozen blocks, all of them are filled
+ * with 1s. */
+static signed char *width_blocks[256];
+
+static void init_width_blocks (void)
+{
+  signed char block[256];
+  int hi, lo, i;
+
+  for (hi = 0; hi < 256; hi++)
+  {
+    for (lo = 0; lo < 256; lo++)
+      block[lo] = wcwidth_ucs_search ((wchar_t) (hi << 8 | lo));
+
+    for (i = 0; i < hi; i++)
+      if (!memcmp (width_blocks[i], block, sizeof (block)))
+	break;
+    if (i < hi)
+      width_blocks[hi] = width_blocks[i];
+    else
+    {
+      width_blocks[hi] = safe_malloc (sizeof (block));
+      memcpy (width_blocks[hi], block, sizeof (block));
+    }
+  }
+}
+
+int wcwidth_ucs(wchar_t ucs)
+{
+  if (ucs < 0 || ucs >= 0x10000)
+    return wcwidth_ucs_search (ucs);
+
+  if (!width_blocks[0])
+    init_width_blocks ();
+  return width_blocks[ucs >> 8][ucs & 0xff];
+}
+
 #endif /* !HAVE_WC_FUNCS */
 
 #if 0 /* original */